@@ -37,10 +37,14 @@
 #include <gensym/immeralgo.hpp>
 #include <gensym/auxiliary.hpp>
 #include <gensym/defs.hpp>
+#include <gensym/arena.hpp>
 #include <gensym/parallel.hpp>
 #include <gensym/monitor.hpp>
 #include <gensym/ptree.hpp>
 #include <gensym/value_ops.hpp>
+#include <gensym/rewrite.hpp>
+#include <gensym/absint.hpp>
+#include <gensym/condset.hpp>
 #include <gensym/filesys.hpp>
 #include <gensym/args.hpp>
 #include <gensym/cli.hpp>
@@ -53,6 +57,7 @@
 #endif
 
 #include <gensym/smt_checker.hpp>
+#include <gensym/gc.hpp>
 #include <gensym/branch.hpp>
 #include <gensym/misc.hpp>
 
@@ -0,0 +1,266 @@
+#ifndef GS_ABSINT_HEADER
+#define GS_ABSINT_HEADER
+
+/* Deciding conditions in the abstract domain */
+
+// The domain of a term (SymV::dom) assumes nothing about its variables. A
+// path condition refines the domains of the variables it bounds (VarDomains,
+// by variable id), and terms over those variables are re-evaluated under the
+// refined domains, so that a branch condition or a symbolic offset can often
+// be decided without the solver. Everything here over-approximates: a
+// condition is only decided when no model of the path condition disagrees.
+
+using VarDomains = immer::map<uint32_t, BVDomain>;
+
+namespace absint {
+
+// Maximum number of nodes re-evaluated for one query
+inline constexpr size_t eval_budget = 256;
+// Maximum number of candidate offsets enumerated for a symbolic location
+inline constexpr size_t offset_limit = 4096;
+
+inline BVDomain var_dom(const VarDomains& env, const SymV* x) {
+  auto d = env.find(*x->vars.ids_begin());
+  return d ? *d : x->dom;
+}
+
+inline BVDomain eval(const PtrVal& e, const VarDomains& env, size_t& budget) {
+  auto dom = dom_of(e);
+  auto k = e.is_unboxed() ? VKind::IntV : e.get()->kind;
+  if (k != VKind::SymV && k != VKind::SymLocV) return dom;
+  auto s = static_cast<const SymV*>(e.get());
+  if (s->bw > 64 || budget == 0) return dom;
+  budget--;
+  if (!s->name.empty()) return var_dom(env, s);
+  bool refined = false;
+  for (auto id = s->vars.ids_begin(); id != s->vars.ids_end() && !refined; id++) {
+    refined = env.count(*id);
+  }
+  if (!refined || s->rands.size() > 3) return dom;
+  BVDomain doms[3];
+  size_t bws[3];
+  for (size_t i = 0; i < s->rands.size(); i++) {
+    doms[i] = eval(s->rands[i], env, budget);
+    bws[i] = bw_of(s->rands[i]);
+  }
+  auto d = bvdomain::transfer(s->rator, doms, bws, s->rands.size(), s->bw);
+  auto m = d.meet(dom, s->bw);
+  return m.is_empty() ? d : m;
+}
+
+inline BVDomain eval(const PtrVal& e, const VarDomains& env) {
+  size_t budget = eval_budget;
+  return eval(e, env, budget);
+}
+
+// -1 if unknown, otherwise the truth value of `cond` under `env`
+inline int decide(const PtrVal& cond, const VarDomains& env) {
+  auto d = eval(cond, env);
+  return d.is_const() ? int(d.lo) : -1;
+}
+
+inline iOP negate_cmp(iOP op) {
+  switch (op) {
+    case iOP::op_eq: return iOP::op_neq;
+    case iOP::op_neq: return iOP::op_eq;
+    case iOP::op_ult: return iOP::op_uge;
+    case iOP::op_uge: return iOP::op_ult;
+    case iOP::op_ule: return iOP::op_ugt;
+    case iOP::op_ugt: return iOP::op_ule;
+    case iOP::op_slt: return iOP::op_sge;
+    case iOP::op_sge: return iOP::op_slt;
+    case iOP::op_sle: return iOP::op_sgt;
+    case iOP::op_sgt: return iOP::op_sle;
+    default: ABORT("not a comparison");
+  }
+}
+
+// `c op x` as `x op' c`
+inline iOP swap_cmp(iOP op) {
+  switch (op) {
+    case iOP::op_ult: return iOP::op_ugt;
+    case iOP::op_ugt: return iOP::op_ult;
+    case iOP::op_ule: return iOP::op_uge;
+    case iOP::op_uge: return iOP::op_ule;
+    case iOP::op_slt: return iOP::op_sgt;
+    case iOP::op_sgt: return iOP::op_slt;
+    case iOP::op_sle: return iOP::op_sge;
+    case iOP::op_sge: return iOP::op_sle;
+    default: return op;
+  }
+}
+
+inline bool is_cmp(iOP op) {
+  switch (op) {
+    case iOP::op_eq: case iOP::op_neq:
+    case iOP::op_ult: case iOP::op_ule: case iOP::op_ugt: case iOP::op_uge:
+    case iOP::op_slt: case iOP::op_sle: case iOP::op_sgt: case iOP::op_sge:
+      return true;
+    default:
+      return false;
+  }
+}
+
+inline bool is_signed_cmp(iOP op) {
+  return op == iOP::op_slt || op == iOP::op_sle || op == iOP::op_sgt || op == iOP::op_sge;
+}
+
+// The operator node `v` (not a variable), or nullptr
+inline const SymV* as_node(const PtrVal& v) {
+  if (v.is_unboxed() || v.get()->kind != VKind::SymV) return nullptr;
+  auto s = static_cast<const SymV*>(v.get());
+  return s->name.empty() ? s : nullptr;
+}
+
+inline const SymV* as_var(const PtrVal& v) {
+  if (v.is_unboxed() || v.get()->kind != VKind::SymV) return nullptr;
+  auto s = static_cast<const SymV*>(v.get());
+  return s->name.empty() || s->bw > 64 ? nullptr : s;
+}
+
+// Narrows the domain of variable `x` to `d` (ignoring contradictions)
+inline void narrow(VarDomains& env, const SymV* x, const BVDomain& d) {
+  auto m = var_dom(env, x).meet(d, x->bw);
+  if (!m.is_empty()) env = env.set(*x->vars.ids_begin(), m);
+}
+
+// Narrows the domain of `t` by `t op c` for a bw-bit constant c, where `t`
+// is a variable, or a zero/sign extension of one
+inline void refine_cmp(VarDomains& env, const PtrVal& t, iOP op, uint64_t c, size_t bw) {
+  auto m = BVDomain::mask(bw);
+  const SymV* x = as_var(t);
+  bool sext = false;
+  if (!x) {
+    auto n = as_node(t);
+    if (!n || (n->rator != iOP::op_zext && n->rator != iOP::op_sext)) return;
+    if (!(x = as_var(n->rands[0]))) return;
+    sext = n->rator == iOP::op_sext;
+  }
+  auto xbw = x->bw;
+  auto xm = BVDomain::mask(xbw);
+  // c is a value of t: its upper bits are zeros, or copies of the sign bit of
+  // its lower xbw bits for a sign extension
+  auto in_range = [&] {
+    bool neg = sext && ((c >> (xbw - 1)) & 1);
+    return (c & ~xm) == (neg ? m & ~xm : 0);
+  };
+  if (op == iOP::op_neq) {
+    // only trims a bound of the interval
+    auto d = var_dom(env, x);
+    if (!in_range()) return;
+    c &= xm;
+    if (d.lo == c && d.lo < d.hi) narrow(env, x, BVDomain::interval(c + 1, d.hi, xbw));
+    else if (d.hi == c && d.lo < d.hi) narrow(env, x, BVDomain::interval(d.lo, c - 1, xbw));
+    return;
+  }
+  if (op == iOP::op_eq) {
+    if (!in_range()) return;
+    narrow(env, x, BVDomain::constant(c, xbw));
+    return;
+  }
+  if (is_signed_cmp(op)) {
+    // the bound as a signed interval of the extended value
+    auto sx = [bw](uint64_t v) { return int64_t(v << (64 - bw)) >> (64 - bw); };
+    int64_t smin = sx(uint64_t(1) << (bw - 1)), smax = sx((uint64_t(1) << (bw - 1)) - 1);
+    int64_t sc = sx(c), lo = smin, hi = smax;
+    switch (op) {
+      case iOP::op_slt: if (sc == smin) return; hi = sc - 1; break;
+      case iOP::op_sle: hi = sc; break;
+      case iOP::op_sgt: if (sc == smax) return; lo = sc + 1; break;
+      case iOP::op_sge: lo = sc; break;
+      default: break;
+    }
+    // as an interval of x
+    if (!sext && xbw != bw) {
+      // a zero extension is non-negative
+      lo = std::max<int64_t>(lo, 0);
+      if (hi < lo) return;
+      narrow(env, x, BVDomain::interval(lo, std::min<uint64_t>(hi, xm), xbw));
+      return;
+    }
+    int64_t xmax = int64_t(xm >> 1), xmin = -xmax - 1;
+    lo = std::max(lo, xmin);
+    hi = std::min(hi, xmax);
+    if (hi < lo) return;
+    if (lo >= 0) narrow(env, x, BVDomain::interval(lo, hi, xbw));
+    else if (hi < 0) narrow(env, x, BVDomain::interval(uint64_t(lo) & xm, uint64_t(hi) & xm, xbw));
+    return;
+  }
+  if (sext && xbw != bw) return;
+  uint64_t lo = 0, hi = m;
+  switch (op) {
+    case iOP::op_ult: if (c == 0) return; hi = c - 1; break;
+    case iOP::op_ule: hi = c; break;
+    case iOP::op_ugt: if (c == m) return; lo = c + 1; break;
+    case iOP::op_uge: lo = c; break;
+    default: return;
+  }
+  if (lo > xm) return;
+  narrow(env, x, BVDomain::interval(lo, std::min(hi, xm), xbw));
+}
+
+// Narrows `env` by the fact that `cond` is `truth`
+inline void refine(VarDomains& env, const PtrVal& cond, bool truth) {
+  auto n = as_node(cond);
+  if (!n) {
+    if (auto x = as_var(cond)) narrow(env, x, BVDomain::constant(truth, 1));
+    return;
+  }
+  auto op = n->rator;
+  if (op == iOP::op_neg) return refine(env, n->rands[0], !truth);
+  if (n->bw == 1 && ((op == iOP::op_and && truth) || (op == iOP::op_or && !truth))) {
+    refine(env, n->rands[0], truth);
+    refine(env, n->rands[1], truth);
+    return;
+  }
+  if (!is_cmp(op)) return;
+  if (!truth) op = negate_cmp(op);
+  auto lhs = n->rands[0], rhs = n->rands[1];
+  auto bw = bw_of(lhs);
+  if (bw > 64) return;
+  auto dl = dom_of(lhs), dr = dom_of(rhs);
+  if (dl.is_const() && !dr.is_const()) {
+    std::swap(lhs, rhs);
+    std::swap(dl, dr);
+    op = swap_cmp(op);
+  }
+  if (!dr.is_const()) return;
+  auto c = dr.lo;
+  // (x & mask) == c
+  if (op == iOP::op_eq) {
+    if (auto a = as_node(lhs); a && a->rator == iOP::op_and) {
+      auto x = as_var(a->rands[0]);
+      auto dm = dom_of(a->rands[1]);
+      if (x && dm.is_const()) {
+        BVDomain d = BVDomain::top(bw);
+        d.ones = c & dm.lo;
+        d.zeros |= ~c & dm.lo;
+        narrow(env, x, d.normalize(bw));
+        return;
+      }
+    }
+  }
+  refine_cmp(env, lhs, op, c, bw);
+}
+
+inline VarDomains refine(VarDomains env, const PtrVal& cond) {
+  refine(env, cond, true);
+  return env;
+}
+
+// The in-bound values of a symbolic offset (in [0, max]) allowed by its domain
+// `d`, in increasing order; false if there may be more than `limit` of them.
+inline bool offset_candidates(const BVDomain& d, uint64_t max, size_t limit, std::vector<uint64_t>& out) {
+  out.clear();
+  if (d.lo > max) return true;
+  auto hi = std::min(d.hi, max);
+  if (hi - d.lo >= limit) return false;
+  for (auto v = d.lo; v <= hi; v++) {
+    if (d.contains(v)) out.push_back(v);
+  }
+  return true;
+}
+
+} // namespace absint
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef GS_ARENA_HEADER
+#define GS_ARENA_HEADER
+
+/* Slab allocation for Value nodes */
+
+// Values are small, immutable, and created at a very high rate. Each thread
+// owns a ValueArena that carves fixed-size slots out of large chunks and keeps
+// one free list per size class, so that a slot released by hash-consing
+// (a duplicate) or by the reclamation pass is reused by the next allocation of
+// the same size class. Chunks are never returned to the OS: the resident size
+// plateaus at the peak number of live values instead of growing with the total
+// number of values ever constructed.
+class ValueArena {
+  static constexpr size_t slot_align = 16;
+  static constexpr size_t num_classes = 16; // slots up to 256 bytes
+  static constexpr size_t chunk_size = 1 << 20;
+
+  struct FreeSlot { FreeSlot* next; };
+
+  FreeSlot* free_slots[num_classes] = {};
+  char* bump = nullptr;
+  char* bump_end = nullptr;
+
+  static size_t size_class(size_t sz) { return (sz + slot_align - 1) / slot_align - 1; }
+  static size_t slot_size(size_t cls) { return (cls + 1) * slot_align; }
+
+public:
+  // Bytes of live Value nodes allocated/freed by this thread; may be negative
+  // if this thread frees more than it allocates (e.g. the reclamation pass).
+  std::atomic<int64_t> live_bytes = 0;
+  // Bytes of chunks obtained from the system allocator
+  std::atomic<size_t> chunk_bytes = 0;
+
+  void* alloc(size_t sz) {
+    auto cls = size_class(sz);
+    if (cls >= num_classes) {
+      live_bytes.fetch_add(sz, std::memory_order_relaxed);
+      return ::operator new(sz);
+    }
+    live_bytes.fetch_add(slot_size(cls), std::memory_order_relaxed);
+    if (auto slot = free_slots[cls]) {
+      free_slots[cls] = slot->next;
+      return slot;
+    }
+    if (bump + slot_size(cls) > bump_end) {
+      bump = static_cast<char*>(::operator new(chunk_size));
+      bump_end = bump + chunk_size;
+      chunk_bytes.fetch_add(chunk_size, std::memory_order_relaxed);
+    }
+    void* p = bump;
+    bump += slot_size(cls);
+    return p;
+  }
+
+  void free(void* p, size_t sz) {
+    auto cls = size_class(sz);
+    if (cls >= num_classes) {
+      live_bytes.fetch_sub(sz, std::memory_order_relaxed);
+      ::operator delete(p);
+      return;
+    }
+    live_bytes.fetch_sub(slot_size(cls), std::memory_order_relaxed);
+    auto slot = static_cast<FreeSlot*>(p);
+    slot->next = free_slots[cls];
+    free_slots[cls] = slot;
+  }
+};
+
+inline std::mutex value_arenas_lock;
+inline std::vector<ValueArena*> value_arenas;
+
+// Note: arenas are intentionally never destroyed, values allocated by a thread
+// are shared with (and may outlive) other threads.
+inline ValueArena& value_arena() {
+  thread_local ValueArena* arena = nullptr;
+  if (!arena) {
+    arena = new ValueArena;
+    const std::scoped_lock lock(value_arenas_lock);
+    value_arenas.push_back(arena);
+  }
+  return *arena;
+}
+
+inline int64_t value_arena_live_bytes() {
+  const std::scoped_lock lock(value_arenas_lock);
+  int64_t sum = 0;
+  for (auto a : value_arenas) sum += a->live_bytes.load(std::memory_order_relaxed);
+  return sum;
+}
+
+inline size_t value_arena_chunk_bytes() {
+  const std::scoped_lock lock(value_arenas_lock);
+  size_t sum = 0;
+  for (auto a : value_arenas) sum += a->chunk_bytes.load(std::memory_order_relaxed);
+  return sum;
+}
+
+#endif
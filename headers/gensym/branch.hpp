@@ -109,18 +109,14 @@ array_lookup(SS ss, PtrVal base, PtrVal offset, size_t esize) {
     auto low_cond = int_op_2(iOP::op_sge, offsym, make_IntV(lower_bound, offsym->get_bw()));
     auto high_cond = int_op_2(iOP::op_sle, offsym, make_IntV(higher_bound, offsym->get_bw()));
     auto pc2 = ss.get_PC().add(low_cond).add(high_cond);
-    auto res = get_sat_value(pc2, offsym);
-    while (res.first) {
+    for (int offset_val : get_sat_values(pc2, offsym, possible_num)) {
       cnt++;
-      int offset_val = res.second;
       auto t_cond = int_op_2(iOP::op_eq, offsym, make_IntV(offset_val, offsym->get_bw()));
       if (1 == cnt) {
         result.push_back(std::make_pair(ss.add_PC(t_cond), baseloc + (offset_val*esize)));
       } else {
         result.push_back(std::make_pair(ss.fork().add_PC(t_cond), baseloc + (offset_val*esize)));
       }
-      pc2 = pc2.add(SymV::neg(t_cond));
-      res = get_sat_value(pc2, offsym);
     }
     ASSERT(cnt > 0, "No satisfiable offset value");
     cov().inc_path(cnt - 1);
@@ -148,20 +144,16 @@ array_lookup_k(SS ss, PtrVal base, PtrVal offset, size_t esize,
     auto low_cond = int_op_2(iOP::op_sge, offsym, make_IntV(lower_bound, offsym->get_bw()));
     auto high_cond = int_op_2(iOP::op_sle, offsym, make_IntV(higher_bound, offsym->get_bw()));
     auto pc2 = ss.get_PC().add(low_cond).add(high_cond);
-    auto res = get_sat_value(pc2, offsym);
-    while (res.first) {
+    for (int offset_val : get_sat_values(pc2, offsym, possible_num)) {
       cnt++;
-      int offset_val = res.second;
       auto t_cond = int_op_2(iOP::op_eq, offsym, make_IntV(offset_val, offsym->get_bw()));
       auto new_loc = baseloc + (offset_val*esize);
       auto new_ss = (1 == cnt) ? ss.add_PC(t_cond) : ss.fork().add_PC(t_cond);
       if (can_par_tp()) {
-        tp.add_task(new_ss.get_ssid(), [new_loc=std::move(new_loc), new_ss=std::move(new_ss), k]{ return k(new_ss, new_loc); });
+        tp.add_task(new_ss.get_ssid(), [new_loc=Rooted<PtrVal>(std::move(new_loc)), new_ss=std::move(new_ss), k]{ return k(new_ss, new_loc.v); });
       } else {
         k(new_ss, new_loc);
       }
-      pc2 = pc2.add(SymV::neg(t_cond));
-      res = get_sat_value(pc2, offsym);
     }
     ASSERT(cnt > 0, "No satisfiable offset value");
     cov().inc_path(cnt - 1);
@@ -299,18 +291,14 @@ array_lookup(SS& ss, PtrVal base, PtrVal offset, size_t esize) {
     auto low_cond = int_op_2(iOP::op_sge, offsym, make_IntV(lower_bound, offsym->get_bw()));
     auto high_cond = int_op_2(iOP::op_sle, offsym, make_IntV(higher_bound, offsym->get_bw()));
     auto pc2 = ss.copy_PC().add(low_cond).add(high_cond);
-    auto res = get_sat_value(pc2, offsym);
-    while (res.first) {
+    for (int offset_val : get_sat_values(pc2, offsym, possible_num)) {
       cnt++;
-      int offset_val = res.second;
       auto t_cond = int_op_2(iOP::op_eq, offsym, make_IntV(offset_val, offsym->get_bw()));
       if (1 == cnt) {
         result.push_back(std::make_pair(std::move(ss.add_PC(t_cond)), baseloc + (offset_val*esize)));
       } else {
         result.push_back(std::make_pair(std::move(ss.fork().add_PC(t_cond)), baseloc + (offset_val*esize)));
       }
-      pc2.add(SymV::neg(t_cond));
-      res = get_sat_value(pc2, offsym);
     }
     ASSERT(cnt > 0, "No satisfiable offset value");
     cov().inc_path(cnt - 1);
@@ -338,20 +326,16 @@ array_lookup_k(SS& ss, PtrVal base, PtrVal offset, size_t esize,
     auto low_cond = int_op_2(iOP::op_sge, offsym, make_IntV(lower_bound, offsym->get_bw()));
     auto high_cond = int_op_2(iOP::op_sle, offsym, make_IntV(higher_bound, offsym->get_bw()));
     auto pc2 = ss.copy_PC().add(low_cond).add(high_cond);
-    auto res = get_sat_value(pc2, offsym);
-    while (res.first) {
+    for (int offset_val : get_sat_values(pc2, offsym, possible_num)) {
       cnt++;
-      int offset_val = res.second;
       auto t_cond = int_op_2(iOP::op_eq, offsym, make_IntV(offset_val, offsym->get_bw()));
       auto new_loc = baseloc + (offset_val*esize);
       auto new_ss = (1 == cnt) ? ss.add_PC(t_cond) : ss.fork().add_PC(t_cond);
       if (can_par_tp()) {
-        tp.add_task(new_ss.get_ssid(), [new_loc=std::move(new_loc), new_ss=std::move(new_ss), k]{ return k((SS&)new_ss, new_loc); });
+        tp.add_task(new_ss.get_ssid(), [new_loc=Rooted<PtrVal>(std::move(new_loc)), new_ss=std::move(new_ss), k]{ return k((SS&)new_ss, new_loc.v); });
       } else {
         k(new_ss, new_loc);
       }
-      pc2.add(SymV::neg(t_cond));
-      res = get_sat_value(pc2, offsym);
     }
     ASSERT(cnt > 0, "No satisfiable offset value");
     cov().inc_path(cnt - 1);
@@ -0,0 +1,313 @@
+#ifndef GS_BVDOMAIN_HEADER
+#define GS_BVDOMAIN_HEADER
+
+/* An abstract domain of bit-vectors: unsigned intervals and known bits */
+
+// Every SymV carries a BVDomain over-approximating the values it may take,
+// computed from its operands at construction. Values are the unsigned
+// (zero-extended) bit-vectors; bit-vectors wider than 64 bits are always top.
+struct BVDomain {
+  uint64_t zeros = 0, ones = 0; // bits known to be 0/1
+  uint64_t lo = 0, hi = ~uint64_t(0);
+
+  static uint64_t mask(size_t bw) { return bw >= 64 ? ~uint64_t(0) : (uint64_t(1) << bw) - 1; }
+
+  static BVDomain top(size_t bw) {
+    BVDomain d;
+    d.zeros = ~mask(bw);
+    d.hi = mask(bw);
+    return d;
+  }
+  static BVDomain constant(uint64_t v, size_t bw) {
+    BVDomain d;
+    v &= mask(bw);
+    d.ones = d.lo = d.hi = v;
+    d.zeros = ~v;
+    return d;
+  }
+  static BVDomain interval(uint64_t lo, uint64_t hi, size_t bw) {
+    BVDomain d = top(bw);
+    d.lo = lo;
+    d.hi = hi;
+    return d.normalize(bw);
+  }
+
+  bool is_const() const { return lo == hi; }
+  bool is_empty() const { return lo > hi || (zeros & ones); }
+  bool contains(uint64_t v) const { return lo <= v && v <= hi && !(v & zeros) && (v & ones) == ones; }
+  // The number of bits known from bit 0 upwards
+  unsigned known_low_bits() const {
+    auto k = zeros | ones;
+    return k == ~uint64_t(0) ? 64 : __builtin_ctzll(~k);
+  }
+
+  // Propagates the information between the interval and the known bits
+  BVDomain& normalize(size_t bw) {
+    zeros |= ~mask(bw);
+    lo = std::max(lo, ones);
+    hi = std::min(hi, ~zeros);
+    if (lo > hi) return *this;
+    // the common prefix of the bounds is known
+    if (auto diff = lo ^ hi) {
+      auto prefix = ~((~uint64_t(0)) >> __builtin_clzll(diff));
+      ones |= lo & prefix;
+      zeros |= ~lo & prefix;
+    } else {
+      ones = lo;
+      zeros = ~lo;
+    }
+    return *this;
+  }
+
+  BVDomain join(const BVDomain& d) const {
+    BVDomain r;
+    r.zeros = zeros & d.zeros;
+    r.ones = ones & d.ones;
+    r.lo = std::min(lo, d.lo);
+    r.hi = std::max(hi, d.hi);
+    return r;
+  }
+  // Note: the result may be empty
+  BVDomain meet(const BVDomain& d, size_t bw) const {
+    BVDomain r;
+    r.zeros = zeros | d.zeros;
+    r.ones = ones | d.ones;
+    r.lo = std::max(lo, d.lo);
+    r.hi = std::min(hi, d.hi);
+    return r.normalize(bw);
+  }
+
+  // The signed interval of a bw-bit domain
+  std::pair<int64_t, int64_t> signed_interval(size_t bw) const {
+    auto half = uint64_t(1) << (bw - 1);
+    auto sx = [bw](uint64_t v) { return int64_t(v << (64 - bw)) >> (64 - bw); };
+    if (hi < half || lo >= half) return { sx(lo), sx(hi) };
+    return { sx(half), sx(half - 1) };
+  }
+};
+
+namespace bvdomain {
+
+// -1 if unknown, otherwise the truth value of `a op b` for bw-bit operands
+inline int decide_cmp(iOP op, const BVDomain& a, const BVDomain& b, size_t bw) {
+  switch (op) {
+    case iOP::op_eq: case iOP::op_neq: {
+      bool ne = (a.ones & b.zeros) || (a.zeros & b.ones) || a.hi < b.lo || b.hi < a.lo;
+      if (ne) return op == iOP::op_neq;
+      if (a.is_const() && b.is_const()) return op == iOP::op_eq;
+      return -1;
+    }
+    case iOP::op_ult: if (a.hi < b.lo) return 1; if (a.lo >= b.hi) return 0; return -1;
+    case iOP::op_ule: if (a.hi <= b.lo) return 1; if (a.lo > b.hi) return 0; return -1;
+    case iOP::op_ugt: return decide_cmp(iOP::op_ult, b, a, bw);
+    case iOP::op_uge: return decide_cmp(iOP::op_ule, b, a, bw);
+    case iOP::op_slt: case iOP::op_sle: {
+      if (bw > 64) return -1;
+      auto [alo, ahi] = a.signed_interval(bw);
+      auto [blo, bhi] = b.signed_interval(bw);
+      if (op == iOP::op_slt) {
+        if (ahi < blo) return 1;
+        if (alo >= bhi) return 0;
+      } else {
+        if (ahi <= blo) return 1;
+        if (alo > bhi) return 0;
+      }
+      return -1;
+    }
+    case iOP::op_sgt: return decide_cmp(iOP::op_slt, b, a, bw);
+    case iOP::op_sge: return decide_cmp(iOP::op_sle, b, a, bw);
+    default: return -1;
+  }
+}
+
+inline BVDomain add(const BVDomain& a, const BVDomain& b, size_t bw, bool sub) {
+  auto m = BVDomain::mask(bw);
+  BVDomain r = BVDomain::top(bw);
+  if (!sub && a.hi <= m - b.hi) {
+    r.lo = a.lo + b.lo;
+    r.hi = a.hi + b.hi;
+  } else if (sub && a.lo >= b.hi) {
+    r.lo = a.lo - b.hi;
+    r.hi = a.hi - b.lo;
+  }
+  // the low bits known in both operands are known in the result
+  size_t k = std::min(a.known_low_bits(), b.known_low_bits());
+  if (k > 0) {
+    auto low = BVDomain::mask(std::min(k, bw));
+    auto v = (sub ? a.ones - b.ones : a.ones + b.ones) & low;
+    r.ones |= v;
+    r.zeros |= ~v & low;
+  }
+  return r.normalize(bw);
+}
+
+inline BVDomain shift(iOP op, const BVDomain& a, uint64_t k, size_t bw) {
+  auto m = BVDomain::mask(bw);
+  if (k >= bw) return op == iOP::op_ashr ? BVDomain::top(bw) : BVDomain::constant(0, bw);
+  BVDomain r = BVDomain::top(bw);
+  switch (op) {
+    case iOP::op_shl:
+      r.ones = (a.ones << k) & m;
+      r.zeros |= (a.zeros << k) | BVDomain::mask(k);
+      if (a.hi <= (m >> k)) {
+        r.lo = a.lo << k;
+        r.hi = a.hi << k;
+      }
+      break;
+    case iOP::op_ashr:
+      // only known when the sign bit is known to be zero
+      if (!(a.zeros & (uint64_t(1) << (bw - 1)))) return r;
+      [[fallthrough]];
+    case iOP::op_lshr:
+      r.ones = a.ones >> k;
+      r.zeros |= (a.zeros >> k) | ~(m >> k);
+      r.lo = a.lo >> k;
+      r.hi = a.hi >> k;
+      break;
+    default: break;
+  }
+  return r.normalize(bw);
+}
+
+// Bits [l, l+bw) of a
+inline BVDomain extract(const BVDomain& a, size_t l, size_t bw) {
+  auto m = BVDomain::mask(bw);
+  BVDomain r = BVDomain::top(bw);
+  r.ones = (a.ones >> l) & m;
+  r.zeros |= a.zeros >> l;
+  // the bounds only carry over if they agree on the bits above
+  auto above = l + bw;
+  if (above >= 64 || (a.lo >> above) == (a.hi >> above)) {
+    r.lo = (a.lo >> l) & m;
+    r.hi = (a.hi >> l) & m;
+  }
+  return r.normalize(bw);
+}
+
+// The domain of `op(args...)`, where args[i] is the domain of a bws[i]-bit
+// operand and bw is the width of the result.
+inline BVDomain transfer(iOP op, const BVDomain* args, const size_t* bws, size_t n, size_t bw) {
+  if (bw > 64) return BVDomain::top(bw);
+  for (size_t i = 0; i < n; i++) {
+    if (bws[i] > 64) return BVDomain::top(bw);
+  }
+  auto m = BVDomain::mask(bw);
+  auto& a = args[0];
+  auto& b = args[1];
+  switch (op) {
+    case iOP::op_add: return add(a, b, bw, false);
+    case iOP::op_sub: return add(a, b, bw, true);
+    case iOP::op_mul: {
+      BVDomain r = BVDomain::top(bw);
+      if (b.hi == 0 || a.hi <= m / b.hi) {
+        r.lo = a.lo * b.lo;
+        r.hi = a.hi * b.hi;
+      }
+      // trailing zeros add up
+      auto tz = [&](const BVDomain& d) -> size_t {
+        auto nz = ~d.zeros & m;
+        return nz ? __builtin_ctzll(nz) : bw;
+      };
+      r.zeros |= BVDomain::mask(std::min(tz(a) + tz(b), bw));
+      return r.normalize(bw);
+    }
+    case iOP::op_udiv:
+      if (b.lo > 0) return BVDomain::interval(a.lo / b.hi, a.hi / b.lo, bw);
+      return BVDomain::top(bw);
+    case iOP::op_urem:
+      if (b.lo > 0) return BVDomain::interval(0, std::min(a.hi, b.hi - 1), bw);
+      return BVDomain::top(bw);
+    case iOP::op_sdiv: case iOP::op_srem: {
+      // as unsigned if both are non-negative
+      auto half = uint64_t(1) << (bw - 1);
+      if (a.hi < half && b.hi < half && b.lo > 0) {
+        return op == iOP::op_sdiv ? BVDomain::interval(a.lo / b.hi, a.hi / b.lo, bw)
+                                  : BVDomain::interval(0, std::min(a.hi, b.hi - 1), bw);
+      }
+      return BVDomain::top(bw);
+    }
+    case iOP::op_and: {
+      BVDomain r = BVDomain::top(bw);
+      r.ones = a.ones & b.ones;
+      r.zeros = a.zeros | b.zeros;
+      r.hi = std::min(a.hi, b.hi);
+      return r.normalize(bw);
+    }
+    case iOP::op_or: {
+      BVDomain r = BVDomain::top(bw);
+      r.ones = a.ones | b.ones;
+      r.zeros = a.zeros & b.zeros;
+      r.lo = std::max(a.lo, b.lo);
+      return r.normalize(bw);
+    }
+    case iOP::op_xor: {
+      BVDomain r = BVDomain::top(bw);
+      auto known = (a.zeros | a.ones) & (b.zeros | b.ones);
+      auto v = a.ones ^ b.ones;
+      r.ones = v & known;
+      r.zeros |= ~v & known;
+      return r.normalize(bw);
+    }
+    case iOP::op_shl: case iOP::op_lshr: case iOP::op_ashr:
+      if (b.is_const()) return shift(op, a, b.lo, bw);
+      return BVDomain::top(bw);
+    case iOP::op_eq: case iOP::op_neq:
+    case iOP::op_uge: case iOP::op_ugt: case iOP::op_ule: case iOP::op_ult:
+    case iOP::op_sge: case iOP::op_sgt: case iOP::op_sle: case iOP::op_slt: {
+      auto t = decide_cmp(op, a, b, bws[0]);
+      return t < 0 ? BVDomain::top(1) : BVDomain::constant(t, 1);
+    }
+    case iOP::op_neg:
+      return a.is_const() ? BVDomain::constant(!a.lo, 1) : BVDomain::top(1);
+    case iOP::op_bvnot: {
+      BVDomain r;
+      r.ones = a.zeros & m;
+      r.zeros = a.ones | ~m;
+      r.lo = m - a.hi;
+      r.hi = m - a.lo;
+      return r.normalize(bw);
+    }
+    case iOP::op_zext: {
+      BVDomain r = a;
+      return r.normalize(bw);
+    }
+    case iOP::op_sext: {
+      auto sign = uint64_t(1) << (bws[0] - 1);
+      if (a.zeros & sign) {
+        BVDomain r = a;
+        return r.normalize(bw);
+      }
+      if (a.ones & sign) {
+        auto ext = m & ~BVDomain::mask(bws[0]);
+        BVDomain r = a;
+        r.zeros &= ~ext;
+        r.ones |= ext;
+        r.lo |= ext;
+        r.hi |= ext;
+        return r.normalize(bw);
+      }
+      return BVDomain::top(bw);
+    }
+    case iOP::op_trunc: return extract(a, 0, bw);
+    case iOP::op_extract: return extract(a, args[2].lo, bw);
+    case iOP::op_concat: {
+      auto wb = bws[1];
+      BVDomain r;
+      r.ones = (a.ones << wb) | b.ones;
+      r.zeros = (a.zeros << wb) | (b.zeros & BVDomain::mask(wb));
+      r.lo = (a.lo << wb) | b.lo;
+      r.hi = (a.hi << wb) | b.hi;
+      return r.normalize(bw);
+    }
+    case iOP::op_ite:
+      if (a.is_const()) return a.lo ? args[1] : args[2];
+      return args[1].join(args[2]).normalize(bw);
+    case iOP::const_true: return BVDomain::constant(1, 1);
+    case iOP::const_false: return BVDomain::constant(0, 1);
+    default: return BVDomain::top(bw);
+  }
+}
+
+} // namespace bvdomain
+
+#endif
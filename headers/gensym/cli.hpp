@@ -20,10 +20,22 @@ static struct option long_options[] =
   {"no-br-cache",                no_argument,       0, 27},
   {"no-cons-indep",              no_argument,       0, 5},
   {"simplify",                   no_argument,       0, 26},
+  {"no-simplify",                no_argument,       0, 31},
+  {"hashcons-shards",            required_argument, 0, 30},
+  {"no-absint",                  no_argument,       0, 32},
+  {"shared-cache-size",          required_argument, 0, 33},
+  {"solver-incremental",         no_argument,       0, 34},
+  {"no-model-reuse",             no_argument,       0, 35},
+  {"persistent-cache",           no_argument,       0, 36},
+  {"persistent-cache-file",      required_argument, 0, 37},
+  {"unsat-core",                 no_argument,       0, 39},
   // Test case generation
   {"output-tests-cov-new",       no_argument,       0, 6},
   {"output-ktest",               no_argument,       0, 7},
   {"output-readable-file-tests", no_argument,       0, 10},
+  {"test-writers",               required_argument, 0, 40},
+  {"test-queue",                 required_argument, 0, 41},
+  {"test-archive",               no_argument,       0, 42},
   // Scheduling
   {"search-strategy",            required_argument, 0, 11},
   {"thread",                     required_argument, 0, 17},
@@ -45,8 +57,11 @@ static struct option long_options[] =
   {"print-cov",                  no_argument,       0, 9},
   {"print-detailed-log",         required_argument, 0, 25},
   {"output-dir",                 required_argument, 0, 23},
+  {"dump-queries",               no_argument,       0, 38},
   {"no-stdout-log",              no_argument,       0, 28},
-  // Next 29
+  // Memory
+  {"gc-threshold",               required_argument, 0, 29},
+  // Next 43
   {0,                            0,                 0, 0 }
 };
 
@@ -65,6 +80,8 @@ inline void set_solver(std::string& solver) {
     solver_kind = SolverKind::z3;
   } else if ("stp" == solver) {
     solver_kind = SolverKind::stp;
+  } else if ("portfolio" == solver) {
+    solver_kind = SolverKind::portfolio;
   } else if ("disable" == solver) {
     use_solver = false;
   } else {
@@ -79,6 +96,8 @@ inline void set_symloc_strategy(std::string& strategy) {
     symloc_strategy = SymLocStrategy::feasible;
   } else if ("all" == strategy) {
     symloc_strategy = SymLocStrategy::all;
+  } else if ("array" == strategy) {
+    symloc_strategy = SymLocStrategy::array;
   } else {
     ABORT("unknown symloc strategy");
   }
@@ -94,9 +113,9 @@ inline void print_help(char* main_name) {
       if (p->has_arg == required_argument) {
         std::string key = p->name;
         if (key == "solver") {
-          printf("={stp,z3,disable}");
+          printf("={stp,z3,portfolio,disable}");
         } else if (key == "symloc-strategy") {
-          printf("={one,feasible,all}");
+          printf("={one,feasible,all,array}");
         } else {
           // TODO: doc for other options
           printf("=<value>");
@@ -231,6 +250,56 @@ inline void handle_cli_args(int argc, char** argv) {
       case 28:
         stdout_log = false;
         break;
+      case 29: {
+        int n = atoi(optarg);
+        gc_threshold = (n > 0) ? n : 0;
+        break;
+      }
+      case 30: {
+        int n = atoi(optarg);
+        hashcons_shards = (n > 0) ? n : 1;
+        objpool.reshard(hashcons_shards);
+        break;
+      }
+      case 31:
+        use_symv_simplify = false;
+        break;
+      case 32:
+        use_absint = false;
+        break;
+      case 33: {
+        int n = atoi(optarg);
+        shared_cache_mb = (n > 0) ? n : 0;
+        break;
+      }
+      case 34:
+        use_incremental = true;
+        break;
+      case 35:
+        use_model_reuse = false;
+        break;
+      case 36:
+        use_persistent_query_cache = true;
+        break;
+      case 37:
+        use_persistent_query_cache = true;
+        persistent_cache_file = std::string(optarg);
+        break;
+      case 38:
+        dump_queries = true;
+        break;
+      case 39:
+        use_unsat_core = true;
+        break;
+      case 40:
+        test_writers = atoi(optarg);
+        break;
+      case 41:
+        test_queue_capacity = std::max(1, atoi(optarg));
+        break;
+      case 42:
+        archive_tests = true;
+        break;
       case '?':
       default:
         print_help(argv[0]);
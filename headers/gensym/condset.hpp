@@ -0,0 +1,72 @@
+#ifndef GS_CONDSET_HEADER
+#define GS_CONDSET_HEADER
+
+/* Sets of path constraints, as keys of the solver caches */
+
+// A set of (hash-consed) constraints is a sorted vector of pointers, with a
+// commutative hash: the sum of the mixed structural hashes of its elements.
+// The hash does not depend on the order in which constraints are added, nor
+// on addresses or ids, so that adding or removing one constraint updates it
+// in constant time and equal sets hash equally across runs.
+class ConstraintSet {
+  std::vector<PtrVal> elems; // sorted by address
+  size_t h = 0;
+
+  static bool less(const PtrVal& a, const PtrVal& b) { return a.bits() < b.bits(); }
+
+  static size_t elem_hash(const PtrVal& v) {
+    uint64_t x = hash_PtrVal{}(v);
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+  }
+
+public:
+  ConstraintSet() = default;
+  template <typename It>
+  ConstraintSet(It first, It last) { insert(first, last); }
+
+  bool insert(const PtrVal& v) {
+    auto it = std::lower_bound(elems.begin(), elems.end(), v, less);
+    if (it != elems.end() && *it == v) return false;
+    elems.insert(it, v);
+    h += elem_hash(v);
+    return true;
+  }
+
+  // Note: sorts once, instead of inserting one by one
+  template <typename It>
+  void insert(It first, It last) {
+    auto n = elems.size();
+    for (; first != last; ++first) elems.push_back(*first);
+    if (elems.size() == n) return;
+    std::sort(elems.begin(), elems.end(), less);
+    elems.erase(std::unique(elems.begin(), elems.end()), elems.end());
+    h = 0;
+    for (auto& v : elems) h += elem_hash(v);
+  }
+
+  bool erase(const PtrVal& v) {
+    auto it = std::lower_bound(elems.begin(), elems.end(), v, less);
+    if (it == elems.end() || *it != v) return false;
+    elems.erase(it);
+    h -= elem_hash(v);
+    return true;
+  }
+
+  bool contains(const PtrVal& v) const { return std::binary_search(elems.begin(), elems.end(), v, less); }
+  size_t size() const { return elems.size(); }
+  bool empty() const { return elems.empty(); }
+  size_t hash() const { return h; }
+  std::vector<PtrVal>::const_iterator begin() const { return elems.begin(); }
+  std::vector<PtrVal>::const_iterator end() const { return elems.end(); }
+
+  bool operator==(const ConstraintSet& rhs) const { return h == rhs.h && elems == rhs.elems; }
+  bool operator!=(const ConstraintSet& rhs) const { return !(*this == rhs); }
+};
+
+struct hash_ConstraintSet {
+  size_t operator()(const ConstraintSet& k) const noexcept { return k.hash(); }
+};
+
+#endif
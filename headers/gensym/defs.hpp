@@ -35,10 +35,19 @@ inline atomic_ulong tt_num_async = 0;
 inline atomic_ulong completed_path_num = 0;
 // Number of queries performed for generating test cases
 inline atomic_ulong generated_test_num = 0;
+// Number of independent partitions of the path conditions of test cases
+inline atomic_ulong test_partition_num = 0;
+// Completed paths waiting for a test writer, the most that waited at once,
+// and the completed paths that had to wait for room in the test queue
+inline atomic_ulong test_queue_pending = 0;
+inline atomic_ulong test_queue_max = 0;
+inline atomic_ulong test_queue_waits = 0;
 // Number of queries performed for checking branch satisfiability
 inline atomic_ulong br_query_num = 0;
 // Number of query cache hits
 inline atomic_ulong cached_query_num = 0;
+// Cached queries found sat by evaluating them under earlier models
+inline atomic_ulong model_reuse_num = 0;
 // Number of concretization queries
 inline atomic_ulong conc_query_num = 0;
 // Number of top-level symbolic constraints
@@ -49,6 +58,67 @@ inline atomic_ulong num_total_size_query_exprs = 0;
 inline atomic_ulong num_check_model = 0;
 // Total sizes of check_model constraint sets
 inline atomic_ulong num_check_model_pc_size = 0;
+// Number of hash-consing lookups, hits in the thread-local front caches,
+// and lookups that had to wait for a shard lock
+inline atomic_ulong hashcons_lookups = 0;
+inline atomic_ulong hashcons_front_hits = 0;
+inline atomic_ulong hashcons_contended = 0;
+// Number of value reclamation passes
+inline atomic_ulong num_gc_passes = 0;
+
+// Rules of the symbolic expression rewriter (see rewrite.hpp)
+enum class RewriteRule {
+  const_fold, commute, identity, annihilate, self_op, sub_const, const_chain,
+  ext_cmp, double_neg, neg_cmp, ext_ext, trunc_ext, extract_full,
+  extract_extract, extract_concat, extract_ext, concat_fuse,
+  ite_same, ite_neg, ite_bool, ite_nested, num_rules
+};
+inline const char* rewrite_rule_names[] = {
+  "const-fold", "commute", "identity", "annihilate", "self-op", "sub-const", "const-chain",
+  "ext-cmp", "double-neg", "neg-cmp", "ext-ext", "trunc-ext", "extract-full",
+  "extract-extract", "extract-concat", "extract-ext", "concat-fuse",
+  "ite-same", "ite-neg", "ite-bool", "ite-nested"
+};
+// Number of applications of each rewrite rule
+inline atomic_ulong rewrite_hits[size_t(RewriteRule::num_rules)] = {};
+// Bytes of Value nodes freed by reclamation passes
+inline atomic_ulong gc_reclaimed_bytes = 0;
+// Queries answered by the subset/superset counterexample cache: unsat by an
+// unsat subset, sat by the model of a superset, or by the model of a subset
+inline atomic_ulong cex_unsat_subset_hits = 0;
+inline atomic_ulong cex_superset_hits = 0;
+inline atomic_ulong cex_subset_model_hits = 0;
+// Unsat cores cached instead of the unsat queries, and the constraints they
+// left out
+inline atomic_ulong unsat_core_num = 0;
+inline atomic_ulong unsat_core_dropped = 0;
+// Lookups of the solver caches by one checker (thread), and the hits in its
+// own caches and in the caches shared by all threads
+struct SolverCacheStat {
+  std::atomic<uint64_t> lookups = 0, local_hits = 0, shared_hits = 0;
+};
+inline std::mutex solver_cache_stats_lock;
+inline std::deque<SolverCacheStat> solver_cache_stats;
+// Number of branches decided by the abstract domain (see absint.hpp), and
+// solver queries avoided by it (in branches and symbolic memory accesses)
+inline atomic_ulong absint_decided_branches = 0;
+inline atomic_ulong absint_avoided_queries = 0;
+// Path conditions found asserted already by incremental solver sessions
+inline atomic_ulong session_reused_conds = 0;
+// Queries raced by the portfolio checker and their winners, and queries it
+// gave to a single backend
+inline atomic_ulong portfolio_races = 0;
+inline atomic_ulong portfolio_stp_wins = 0;
+inline atomic_ulong portfolio_z3_wins = 0;
+inline atomic_ulong portfolio_single_queries = 0;
+// Symbolic accesses whose offsets were enumerated, the solver calls they
+// cost in total, and the most calls of one access
+inline atomic_ulong sym_access_num = 0;
+inline atomic_ulong sym_access_queries = 0;
+inline atomic_ulong sym_access_max_queries = 0;
+// Queries answered by the persistent query cache, and records written to it
+inline atomic_ulong persistent_cache_hits = 0;
+inline atomic_ulong persistent_cache_writes = 0;
 
 /* Global options */
 
@@ -63,20 +133,45 @@ inline bool use_solver = true;
 inline bool use_global_solver = false;
 // Use hash consing or not
 inline bool use_hashcons = true;
+// Number of shards of the hash-consing pool (rounded up to a power of two)
+inline unsigned int hashcons_shards = 64;
 // Use object caching or not
 inline bool use_objcache = true;
 // Use counterexample caching or not
 inline bool use_cexcache = true;
 // Use branch query caching or not
 inline bool use_brcache = true;
+// Size (in MB) of the solver caches shared by threads (0 disables sharing)
+inline unsigned int shared_cache_mb = 256;
 // Use constraint independence resolving or not
 inline bool use_cons_indep = true;
+// Keep the solver context aligned with the path condition of the current
+// state, and check the sides of a branch under assumptions
+inline bool use_incremental = false;
+// Try earlier models on branch conditions before invoking the solver
+inline bool use_model_reuse = true;
+// Cache the unsat cores of unsat queries, rather than the queries
+inline bool use_unsat_core = false;
+// File of the query cache kept across runs ("" for query-cache.bin in the
+// output folder), if enabled
+inline bool use_persistent_query_cache = false;
+inline std::string persistent_cache_file;
+// Log the queries that reach the solver to queries.bin in the output folder
+inline bool dump_queries = false;
 // Only generate testcases for states that cover new blocks or not
 inline bool only_output_covernew = false;
 // Output ktest format or not
 inline bool output_ktest = false;
 // Prefer generating human-readable file test cases
 inline bool readable_file_tests = false;
+// Append test cases to tests.bin in the output folder, instead of writing a
+// file for each in the tests folder
+inline bool archive_tests = false;
+// Number of threads writing the test cases of completed paths (0 writes them
+// on the thread that completed the path)
+inline unsigned int test_writers = 0;
+// The number of completed paths that can wait for a test writer
+inline unsigned int test_queue_capacity = 64;
 // Only compatible when using KLEE's POSIX model at the momemt (?)
 // Simulate possible failure in external functions (results in state forking)
 // Currently including malloc, calloc, memalign. GW: what else?
@@ -94,8 +189,14 @@ inline bool print_cov_detail = false;
 inline uint32_t print_detailed_log = 0;
 // The maximum size of symbolic location (used in memory read)
 inline unsigned int max_sym_array_size = 0;
-// Use simplification when constructing SymV values
-inline bool use_symv_simplify = false;
+// Rewrite (simplify) operator nodes when constructing SymV values
+inline bool use_symv_simplify = true;
+// Maximum number of rule applications triggered by constructing one SymV
+inline unsigned int rewrite_budget = 32;
+// Decide branches and bound symbolic offsets with the abstract domain of terms
+inline bool use_absint = true;
+// Live Value bytes (in MB) that triggers a reclamation pass (0 disables reclamation)
+inline unsigned int gc_threshold = 0;
 
 // Output directory name
 inline std::string output_dir_str = std::string("gensym-") + get_current_datetime();
@@ -112,7 +213,7 @@ enum class SearcherKind { randomPath, randomWeight };
 // The path searcher to be used
 inline SearcherKind searcher_kind = SearcherKind::randomWeight;
 
-enum class SolverKind { z3, stp };
+enum class SolverKind { z3, stp, portfolio };
 // The backend SMT solver to be used
 inline SolverKind solver_kind = SolverKind::stp;
 
@@ -140,12 +241,15 @@ inline atomic_ulong conc_solver_time = 0;
 inline atomic_ulong gen_test_time = 0;
 // Time spent in add_constraint to the solver
 inline atomic_ulong add_cons_time = 0;
+// Time spent in reclaiming unreachable values
+inline atomic_ulong gc_time = 0;
 
 // Different strategies to handle symbolic pointer index read/write
 // one:       only search one feasible concrete index
 // feasible:  search all feasible concrete indexes
 // all:       enumerate all possible indexes (feasible or not)
-enum class SymLocStrategy { one, feasible, all };
+// array:     read the object as an SMT array at the symbolic index
+enum class SymLocStrategy { one, feasible, all, array };
 
 inline SymLocStrategy symloc_strategy = SymLocStrategy::all;
 
@@ -155,7 +259,9 @@ enum class iOP {
   op_sge, op_sgt, op_sle, op_slt, op_neq,
   op_shl, op_lshr, op_ashr, op_and, op_or, op_xor,
   op_urem, op_srem, op_neg, op_sext, op_zext, op_trunc,
-  op_concat, op_extract, op_ite, op_bvnot, const_true, const_false
+  op_concat, op_extract, op_ite, op_bvnot, const_true, const_false,
+  // the bytes of an object as an array, and a byte of it at an index
+  op_array, op_select
 };
 
 enum class fOP {
@@ -200,6 +306,8 @@ inline std::string int_op_string(iOP op) {
     case iOP::op_bvnot: return "bvnot";
     case iOP::const_false: return "false";
     case iOP::const_true:  return "true";
+    case iOP::op_array: return "array";
+    case iOP::op_select: return "select";
   }
   return "unknown op";
 }
@@ -80,6 +80,7 @@ inline T __sym_exit(SS& state, List<PtrVal>& args, __Cont<T> k) {
     set_exit_code(status);
     return k(state, nullptr);
   } else {
+    flush_tests();
     cov().print_all(true);
     cov().print_all(true, std::cout);
     _exit(status);
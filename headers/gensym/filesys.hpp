@@ -58,6 +58,12 @@ struct File: public Printable {
   }
   File(const File& f) = default;
 
+  void trace(GCMarker& m) const {
+    m.mark_all(content);
+    m.mark_all(stat);
+    for (auto& p: children) p.second->trace(m);
+  }
+
   /* NOTE: should only manipulate File objects through pointers <2022-07-11, David Deng> */
   /* NOTE: parent and children will not be copied <2022-07-11, David Deng> */
   /* Q: usage? <2022-07-11, David Deng> */
@@ -154,6 +160,13 @@ struct FS: public Printable {
   }
   FS(const FS &fs) = default;
 
+  void trace(GCMarker& m) const {
+    m.mark_all(preferred_cex);
+    m.mark_all(statfs);
+    for (auto& p: opened_files) p.second->file->trace(m);
+    if (root_file) root_file->trace(m);
+  }
+
   // default constructor, initialize fields to default values
   FS() :
     next_fd(3), root_file(make_SymFile("/", 0)) {
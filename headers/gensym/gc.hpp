@@ -0,0 +1,119 @@
+#ifndef GS_GC_HEADER
+#define GS_GC_HEADER
+
+/* Reclamation of unreachable values */
+
+// A pass marks every value reachable from a live symbolic state (the roots
+// registered by GCRoot<SS>), then sweeps the hash-consing pool: unmarked
+// values are removed from the pool and returned to their arena. Solver caches
+// are weak and are purged of entries referring to swept values.
+// Passes run at a safepoint where all worker threads of the thread pool are
+// parked between two tasks, so no value is held by a running task. Pending
+// tasks must keep their values through roots: the states they capture, and
+// Rooted for any other value a task of the runtime captures (e.g. the
+// location picked for a symbolic offset). Test writers are paused between
+// two jobs, and the jobs waiting for them are roots as well.
+
+// A value (or list of values) captured by a pending task next to its state
+template <typename T>
+struct Rooted : public GCRoot<Rooted<T>> {
+  T v;
+  Rooted(T v) : v(std::move(v)) {}
+  void trace(GCMarker& m) const {
+    if constexpr (std::is_same_v<T, PtrVal>) m.mark(v);
+    else m.mark_all(v);
+  }
+};
+
+inline std::mutex gc_lock;
+inline std::condition_variable gc_cv;
+inline size_t gc_parked = 0;
+inline uint64_t gc_round = 0;
+inline std::atomic<bool> gc_requested = false;
+// Live bytes at which the next pass is triggered
+inline std::atomic<int64_t> gc_trigger_bytes = 0;
+
+inline void collect_values() {
+  auto start = steady_clock::now();
+  int64_t live_before = value_arena_live_bytes();
+  if (++value_gc_epoch == gc_pinned_mark) value_gc_epoch = 1;
+
+  test_queue.pause();
+  GCMarker marker;
+  GCRoot<SS>::trace_all(marker);
+  GCRoot<TestJob>::trace_all(marker);
+  GCRoot<Rooted<PtrVal>>::trace_all(marker);
+  GCRoot<Rooted<List<PtrVal>>>::trace_all(marker);
+  var_table.for_each([&](const PtrVal& v) { marker.mark(v); });
+  marker.drain();
+  checker_manager.release_dead_values();
+
+  std::vector<PtrVal> dead;
+  objpool.for_each([&](const PtrVal& v) {
+    if (!gc_is_live(v)) dead.push_back(v);
+  });
+  objpool.clear_fronts();
+  // Note: all dead values are erased before any is deleted, as erasing
+  // rehashes (and compares) values that may refer to other dead values.
+  for (auto& v : dead) objpool.erase(v);
+  for (auto& v : dead) delete v.get();
+  test_queue.resume();
+
+  int64_t live_after = value_arena_live_bytes();
+  gc_trigger_bytes = std::max(int64_t(gc_threshold) << 20, 2 * live_after);
+  num_gc_passes++;
+  gc_reclaimed_bytes += std::max(int64_t(0), live_before - live_after);
+  auto end = steady_clock::now();
+  gc_time += duration_cast<microseconds>(end - start).count();
+}
+
+// Called by each worker of the thread pool before picking up a task.
+inline void value_gc_safepoint(const std::atomic<bool>& running) {
+  if (!value_gc_armed) return;
+  if (!gc_requested) {
+    if (value_arena_live_bytes() < gc_trigger_bytes) return;
+    gc_requested = true;
+  }
+  std::unique_lock<std::mutex> lk(gc_lock);
+  if (!gc_requested) return;
+  auto round = gc_round;
+  if (++gc_parked == tp.thread_num) {
+    collect_values();
+    gc_parked = 0;
+    gc_requested = false;
+    gc_round++;
+    lk.unlock();
+    gc_cv.notify_all();
+    return;
+  }
+  while (round == gc_round) {
+    gc_cv.wait_for(lk, milliseconds(100));
+    // The pool is shutting down, some workers may never come back
+    if (!running && round == gc_round) { gc_parked--; return; }
+  }
+}
+
+// Reclamation is only sound when the states are the only owners of values
+// between two tasks, which is the case for the thread pool with the
+// transient (imperative) state. Values created before this point (globals,
+// the initial heap and filesystem) are pinned and never reclaimed.
+inline void arm_value_gc() {
+  if (gc_threshold == 0) return;
+#ifdef PURE_STATE
+  std::cout << "Value reclamation is not supported with the pure state; disabled\n";
+  gc_threshold = 0;
+  return;
+#endif
+  if (!use_thread_pool || !use_hashcons) {
+    std::cout << "Value reclamation requires --thread and hash-consing; disabled\n";
+    gc_threshold = 0;
+    return;
+  }
+  // Force the lazily-created singletons so that they are pinned
+  make_UnInitV();
+  make_LocV_null();
+  gc_trigger_bytes = int64_t(gc_threshold) << 20;
+  value_gc_armed = true;
+}
+
+#endif
@@ -59,12 +59,9 @@ inline int write_string(FILE *f, const char *value) {
   return 1;
 }
 
-inline int kTest_toFile(KTest *bo, const char *path) {
-  FILE *f = fopen(path, "wb");
+inline int kTest_toStream(KTest *bo, FILE *f) {
   unsigned i;
 
-  if (!f)
-    goto error;
   if (fwrite(KTEST_MAGIC, strlen(KTEST_MAGIC), 1, f)!=1)
     goto error;
   if (!write_uint32(f, KTEST_VERSION))
@@ -94,13 +91,98 @@ inline int kTest_toFile(KTest *bo, const char *path) {
       goto error;
   }
 
-  fclose(f);
-
   return 1;
  error:
-  if (f) fclose(f);
-
   return 0;
 }
 
+inline int kTest_toFile(KTest *bo, const char *path) {
+  FILE *f = fopen(path, "wb");
+  if (!f)
+    return 0;
+  int ok = kTest_toStream(bo, f);
+  if (fclose(f) != 0)
+    ok = 0;
+  return ok;
+}
+
+/* Reading a KTest back (e.g. from a test archive); unlike KLEE's
+ * kTest_fromFile, it reads from memory. */
+
+inline int read_uint32(const unsigned char *&p, const unsigned char *end, unsigned *value) {
+  if (end - p < 4)
+    return 0;
+  *value = (unsigned(p[0]) << 24) | (unsigned(p[1]) << 16) | (unsigned(p[2]) << 8) | unsigned(p[3]);
+  p += 4;
+  return 1;
+}
+
+inline int read_string(const unsigned char *&p, const unsigned char *end, char **value) {
+  unsigned len;
+  if (!read_uint32(p, end, &len) || unsigned(end - p) < len)
+    return 0;
+  *value = new char[len + 1];
+  memcpy(*value, p, len);
+  (*value)[len] = 0;
+  p += len;
+  return 1;
+}
+
+inline void kTest_free(KTest *bo) {
+  if (bo->args) {
+    for (unsigned i = 0; i < bo->numArgs; i++)
+      delete[] bo->args[i];
+    delete[] bo->args;
+  }
+  if (bo->objects) {
+    for (unsigned i = 0; i < bo->numObjects; i++) {
+      delete[] bo->objects[i].name;
+      delete[] bo->objects[i].bytes;
+    }
+    delete[] bo->objects;
+  }
+  delete bo;
+}
+
+/* Returns null if `data` is not a KTest file of version 3 */
+inline KTest *kTest_fromBuffer(const unsigned char *data, size_t size) {
+  const unsigned char *p = data, *end = data + size;
+  size_t magic_len = strlen(KTEST_MAGIC);
+  if (size < magic_len || memcmp(data, KTEST_MAGIC, magic_len) != 0)
+    return nullptr;
+  p += magic_len;
+  KTest *bo = new KTest();
+  unsigned i;
+  if (!read_uint32(p, end, &bo->version) || bo->version != KTEST_VERSION)
+    goto error;
+  if (!read_uint32(p, end, &bo->numArgs) || bo->numArgs > unsigned(end - p))
+    goto error;
+  bo->args = new char*[bo->numArgs]();
+  for (i=0; i<bo->numArgs; i++) {
+    if (!read_string(p, end, &bo->args[i]))
+      goto error;
+  }
+  if (!read_uint32(p, end, &bo->symArgvs))
+    goto error;
+  if (!read_uint32(p, end, &bo->symArgvLen))
+    goto error;
+  if (!read_uint32(p, end, &bo->numObjects) || bo->numObjects > unsigned(end - p))
+    goto error;
+  bo->objects = new KTestObject[bo->numObjects]();
+  for (i=0; i<bo->numObjects; i++) {
+    KTestObject *o = &bo->objects[i];
+    if (!read_string(p, end, &o->name))
+      goto error;
+    if (!read_uint32(p, end, &o->numBytes) || unsigned(end - p) < o->numBytes)
+      goto error;
+    o->bytes = new unsigned char[o->numBytes];
+    memcpy(o->bytes, p, o->numBytes);
+    p += o->numBytes;
+  }
+  return bo;
+ error:
+  kTest_free(bo);
+  return nullptr;
+}
+
 #endif /* GS_KTEST_H */
@@ -8,7 +8,7 @@ inline std::monostate gs_dummy(SS&, immer::flex_vector<PtrVal>, std::function<st
 }
 inline std::monostate start_gs_main(SS& state, immer::flex_vector<PtrVal> args, std::function<std::monostate(SS&, PtrVal)> cont) {
   if (can_par_tp()) {
-    tp.add_task(1, [=] () mutable { return gs_main(state, args, cont); });
+    tp.add_task(1, [state, args=Rooted<List<PtrVal>>(args), cont] () mutable { return gs_main(state, args.v, cont); });
     return std::monostate{};
   }
   return gs_main(state, args, cont);
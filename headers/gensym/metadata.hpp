@@ -29,6 +29,7 @@ public:
         "preferred_cex : " << vec_to_string<List, PtrVal>(preferred_cex) << ")";
       return ss.str();
     }
+    void trace(GCMarker& m) const { m.mark_all(preferred_cex); }
 
 #ifdef PURE_STATE
     MetaData add_incoming_block(BlockLabel blabel) {
@@ -25,6 +25,7 @@ inline void prelude(int argc, char** argv) {
   handle_cli_args(argc, argv);
   init_output_folder();
   init_solvers();
+  arm_value_gc();
   cov().start_monitor();
 }
 
@@ -32,6 +33,8 @@ inline void epilogue() {
   if (can_par_tp()) {
     tp.wait_for_tasks();
   }
+  test_queue.stop();
+  test_archive.close();
   cov().stop_monitor();
   cov().print_all(true);
   gs_log.close();
@@ -0,0 +1,246 @@
+#ifndef GS_MODEL_EVAL_HEADER
+#define GS_MODEL_EVAL_HEADER
+
+/* Evaluating terms under models */
+
+// A set of terms lowered once into a flat post-order program over uint64_t
+// registers (one per distinct node of the DAG), which is then run against
+// Assignments without building IntV values or allocating. Unassigned
+// variables are 0, as in CheckerSTP::__eval_model, and operators have the
+// semantics of the solvers (e.g. x / 0 is all ones, shifting by the width or
+// more gives 0). Terms wider than 64 bits cannot be compiled. A select reads
+// the registers of the bytes of its array, kept once per array in `tables`.
+class ModelProgram {
+  struct Insn {
+    iOP op;
+    enum : uint8_t { Const, Var, Op, Select } kind;
+    uint8_t bw;   // of the result
+    uint8_t obw;  // of the first operand
+    uint32_t a[3];
+    uint64_t k;   // the constant, the index of the variable, or of the table
+  };
+  std::vector<Insn> code;
+  std::vector<PtrVal> vars;
+  std::vector<uint32_t> roots;
+  std::vector<uint32_t> tables;
+  phmap::flat_hash_map<PtrVal, uint32_t> regs_of;
+  phmap::flat_hash_map<PtrVal, uint32_t> tables_of;
+  bool ok = true;
+
+  static int64_t sx(uint64_t v, size_t bw) {
+    return bw >= 64 ? int64_t(v) : int64_t(v << (64 - bw)) >> (64 - bw);
+  }
+
+  uint32_t emit(Insn i) {
+    code.push_back(i);
+    return code.size() - 1;
+  }
+
+  // The register of term `e`, or 0 (after setting !ok) if it is unsupported
+  uint32_t compile(const PtrVal& e) {
+    if (auto it = regs_of.find(e); it != regs_of.end()) return it->second;
+    auto bw = bw_of(e);
+    if (bw > 64 || bw == 0) { ok = false; return 0; }
+    auto d = dom_of(e);
+    uint32_t r;
+    if (d.is_const()) {
+      r = emit({ iOP::const_true, Insn::Const, uint8_t(bw), 0, {}, d.lo });
+    } else if (e.is_unboxed() || e.get()->kind != VKind::SymV) {
+      ok = false;
+      return 0;
+    } else if (auto s = static_cast<const SymV*>(e.get()); !s->name.empty()) {
+      vars.push_back(e);
+      r = emit({ iOP::const_true, Insn::Var, uint8_t(bw), 0, {}, vars.size() - 1 });
+    } else if (s->rator == iOP::op_select) {
+      Insn i { iOP::op_select, Insn::Select, uint8_t(bw), 0, {}, 0 };
+      i.a[0] = compile(s->rands[1]);
+      auto& bytes = static_cast<const SymV*>(s->rands[0].get())->rands;
+      i.a[1] = bytes.size();
+      if (auto it = tables_of.find(s->rands[0]); it != tables_of.end()) {
+        i.k = it->second;
+      } else {
+        std::vector<uint32_t> t;
+        for (size_t j = 0; j < bytes.size() && ok; j++) t.push_back(compile(bytes[j]));
+        i.k = tables.size();
+        tables.insert(tables.end(), t.begin(), t.end());
+        tables_of.emplace(s->rands[0], i.k);
+      }
+      if (!ok) return 0;
+      r = emit(i);
+    } else {
+      if (s->rands.size() > 3 || s->rator == iOP::op_array) { ok = false; return 0; }
+      Insn i { s->rator, Insn::Op, uint8_t(bw), 0, {}, 0 };
+      for (size_t j = 0; j < s->rands.size() && ok; j++) i.a[j] = compile(s->rands[j]);
+      if (!ok) return 0;
+      if (!s->rands.empty()) i.obw = bw_of(s->rands[0]);
+      if (s->rator == iOP::op_concat) i.k = bw_of(s->rands[1]);
+      r = emit(i);
+    }
+    regs_of.emplace(e, r);
+    return r;
+  }
+
+  static uint64_t exec(const Insn& i, uint64_t x, uint64_t y, uint64_t z) {
+    uint64_t v;
+    switch (i.op) {
+      case iOP::op_add: v = x + y; break;
+      case iOP::op_sub: v = x - y; break;
+      case iOP::op_mul: v = x * y; break;
+      case iOP::op_udiv: v = y == 0 ? ~uint64_t(0) : x / y; break;
+      case iOP::op_urem: v = y == 0 ? x : x % y; break;
+      case iOP::op_sdiv: {
+        auto l = sx(x, i.bw), r = sx(y, i.bw);
+        if (r == 0) v = l < 0 ? 1 : ~uint64_t(0);
+        else if (r == -1) v = uint64_t(0) - uint64_t(l);
+        else v = uint64_t(l / r);
+        break;
+      }
+      case iOP::op_srem: {
+        auto l = sx(x, i.bw), r = sx(y, i.bw);
+        v = (r == 0) ? x : (r == -1) ? 0 : uint64_t(l % r);
+        break;
+      }
+      case iOP::op_eq: v = x == y; break;
+      case iOP::op_neq: v = x != y; break;
+      case iOP::op_ult: v = x < y; break;
+      case iOP::op_ule: v = x <= y; break;
+      case iOP::op_ugt: v = x > y; break;
+      case iOP::op_uge: v = x >= y; break;
+      case iOP::op_slt: v = sx(x, i.obw) < sx(y, i.obw); break;
+      case iOP::op_sle: v = sx(x, i.obw) <= sx(y, i.obw); break;
+      case iOP::op_sgt: v = sx(x, i.obw) > sx(y, i.obw); break;
+      case iOP::op_sge: v = sx(x, i.obw) >= sx(y, i.obw); break;
+      case iOP::op_shl: v = y >= i.bw ? 0 : x << y; break;
+      case iOP::op_lshr: v = y >= i.bw ? 0 : x >> y; break;
+      case iOP::op_ashr: v = uint64_t(sx(x, i.bw) >> std::min<uint64_t>(y, i.bw - 1)); break;
+      case iOP::op_and: v = x & y; break;
+      case iOP::op_or: v = x | y; break;
+      case iOP::op_xor: v = x ^ y; break;
+      case iOP::op_neg: v = !x; break;
+      case iOP::op_bvnot: v = ~x; break;
+      case iOP::op_sext: v = uint64_t(sx(x, i.obw)); break;
+      case iOP::op_zext: case iOP::op_trunc: v = x; break;
+      case iOP::op_concat: v = (x << i.k) | y; break;
+      case iOP::op_extract: v = x >> z; break;
+      case iOP::op_ite: v = x ? y : z; break;
+      case iOP::const_true: v = 1; break;
+      case iOP::const_false: v = 0; break;
+      default: ABORT("unknown operator in a model program");
+    }
+    return v & BVDomain::mask(i.bw);
+  }
+
+public:
+  ModelProgram() = default;
+  template <typename Terms>
+  explicit ModelProgram(const Terms& ts) {
+    for (auto& t : ts) add(t);
+  }
+
+  // Adds a term to evaluate, returns its index in the results
+  size_t add(const PtrVal& t) {
+    roots.push_back(compile(t));
+    return roots.size() - 1;
+  }
+
+  void clear() {
+    code.clear();
+    vars.clear();
+    roots.clear();
+    tables.clear();
+    regs_of.clear();
+    tables_of.clear();
+    ok = true;
+  }
+
+  // Whether all the terms are supported
+  bool valid() const { return ok; }
+  size_t size() const { return roots.size(); }
+  size_t num_regs() const { return code.size(); }
+
+  // Runs the program under `n` models at once, one column of `regs` for each;
+  // the result of term r under model j is then `result(regs, n, r, j)`.
+  // Note: `regs` is only reallocated when it is too small.
+  void run(const Assignment* const* models, size_t n, std::vector<uint64_t>& regs) const {
+    ASSERT(ok, "running an invalid model program");
+    if (regs.size() < code.size() * n) regs.resize(code.size() * n);
+    auto R = regs.data();
+    for (size_t p = 0; p < code.size(); p++) {
+      auto& i = code[p];
+      auto out = R + p * n;
+      switch (i.kind) {
+        case Insn::Const:
+          std::fill(out, out + n, i.k);
+          break;
+        case Insn::Var:
+          for (size_t j = 0; j < n; j++) {
+            auto it = models[j]->find(vars[i.k]);
+            out[j] = it == models[j]->end() ? 0 : uint64_t(it->second) & BVDomain::mask(i.bw);
+          }
+          break;
+        case Insn::Op: {
+          auto x = R + i.a[0] * n, y = R + i.a[1] * n, z = R + i.a[2] * n;
+          for (size_t j = 0; j < n; j++) out[j] = exec(i, x[j], y[j], z[j]);
+          break;
+        }
+        case Insn::Select: {
+          auto x = R + i.a[0] * n;
+          auto t = tables.data() + i.k;
+          for (size_t j = 0; j < n; j++) out[j] = x[j] < i.a[1] ? R[t[x[j]] * n + j] : 0;
+          break;
+        }
+      }
+    }
+  }
+
+  uint64_t result(const std::vector<uint64_t>& regs, size_t n, size_t r, size_t j) const {
+    return regs[roots[r] * n + j];
+  }
+
+  uint64_t eval(const Assignment& a, std::vector<uint64_t>& regs, size_t r = 0) const {
+    const Assignment* m = &a;
+    run(&m, 1, regs);
+    return result(regs, 1, r, 0);
+  }
+};
+
+namespace model_eval {
+
+// Evaluates a term of at most 64 bits under `m`, false if it is wider
+inline bool eval_term(const Assignment& m, const PtrVal& v, uint64_t& out) {
+  if (auto s = v->to_SymV(); s && s->is_var() && s->bw <= 64) {
+    auto it = m.find(v);
+    out = it == m.end() ? 0 : uint64_t(it->second) & BVDomain::mask(s->bw);
+    return true;
+  }
+  // Note: the program is reused, so that compiling a term does not allocate
+  thread_local ModelProgram p;
+  thread_local std::vector<uint64_t> regs;
+  p.clear();
+  p.add(v);
+  if (!p.valid()) return false;
+  out = p.eval(m, regs);
+  return true;
+}
+
+// The first of the `n` models under which all the terms of `p` hold, or -1
+inline int first_model(const ModelProgram& p, const Assignment* const* models, size_t n) {
+  if (!p.valid() || n == 0) return -1;
+  thread_local std::vector<uint64_t> regs;
+  p.run(models, n, regs);
+  for (size_t j = 0; j < n; j++) {
+    bool all = true;
+    for (size_t r = 0; r < p.size() && all; r++) all = p.result(regs, n, r, j) == 1;
+    if (all) return j;
+  }
+  return -1;
+}
+
+template <typename Set>
+inline int first_model(const Set& conds, const Assignment* const* models, size_t n) {
+  return first_model(ModelProgram(conds), models, n);
+}
+
+} // namespace model_eval
+
+#endif
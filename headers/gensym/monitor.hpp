@@ -1,6 +1,8 @@
 #ifndef GS_MON_HEADER
 #define GS_MON_HEADER
 
+inline void flush_tests();
+
 /* Coverage information */
 
 struct Monitor {
@@ -120,8 +122,16 @@ struct Monitor {
     void print_thread_pool(std::ostream& out) {
       out << "#threads: " << n_thread << "; #task-in-q: " << tp.tasks_num_queued() << "; ";
     }
+    void print_gc_stat(std::ostream& out) {
+      out << "#gc: " << num_gc_passes << " ("
+          << (gc_reclaimed_bytes / 1048576) << "MB reclaimed/"
+          << (value_arena_live_bytes() >> 20) << "MB live/"
+          << (value_arena_chunk_bytes() >> 20) << "MB arena; "
+          << (gc_time / 1.0e6) << "s); ";
+    }
     void print_query_stat(std::ostream& out) {
-      out << "#queries: " << br_query_num << "/" << generated_test_num << " (" << cached_query_num << ")\n";
+      out << "#sat by model reuse: " << model_reuse_num << "; "
+          << "#queries: " << br_query_num << "/" << generated_test_num << " (" << cached_query_num << ")\n";
     }
     void print_time(bool done, std::ostream& out) {
       steady_clock::time_point now = done ? stop : steady_clock::now();
@@ -133,15 +143,79 @@ struct Monitor {
             << "Concretize solver: " << (conc_solver_time / 1.0e6) << "s; "
             << "#Concretize query: " << conc_query_num << "\n";
 
+        out << "Symbolic accesses: " << sym_access_num << "; "
+            << "#solver calls: " << sym_access_queries << " ("
+            << (sym_access_queries / std::max(1.0, 1.0 * sym_access_num)) << " avg/"
+            << sym_access_max_queries << " max)\n";
+
         out << "Branch solver: " << (br_solver_time / 1.0e6) << "s; "
             << "else-br: " << (else_miss_time / 1.0e6) << "s; "
             << "then-br: " << (then_miss_time / 1.0e6) << "s; "
             << "both-br: " << (both_miss_time / 1.0e6) << "s\n";
 
+        if (test_writers > 0) {
+          out << "Test queue: #pending: " << test_queue_pending << "; "
+              << "#max pending: " << test_queue_max << "; "
+              << "#waits for room: " << test_queue_waits << "\n";
+        }
+
         out << "Completed path: " << completed_path_num << "; "
+            << "#test partitions: " << test_partition_num << "; "
             << "Avg pc size: " << (num_check_model_pc_size/(1.0*num_check_model)) << "; "
             << "#query sym constraints: " << num_query_exprs << "; "
             << "Avg #query expr size: " << (num_total_size_query_exprs/(1.0*num_query_exprs)) << "\n";
+
+        out << "Hash-consing: " << hashcons_lookups << " lookups; "
+            << "front hit: " << (100.0 * hashcons_front_hits / std::max(1ul, hashcons_lookups.load())) << "%; "
+            << "#contended: " << hashcons_contended << "; "
+            << "#shards: " << hashcons_shards << "\n";
+
+        out << "Rewrites:";
+        for (size_t r = 0; r < size_t(RewriteRule::num_rules); r++) {
+          if (auto n = rewrite_hits[r].load()) out << " " << rewrite_rule_names[r] << " " << n << ";";
+        }
+        out << "\n";
+
+        out << "Cex cache: "
+            << "#unsat subset: " << cex_unsat_subset_hits << "; "
+            << "#sat superset: " << cex_superset_hits << "; "
+            << "#sat subset model: " << cex_subset_model_hits << "\n";
+
+        if (use_unsat_core) {
+          out << "Unsat cores: " << unsat_core_num << "; "
+              << "#constraints left out: " << unsat_core_dropped << " ("
+              << (unsat_core_dropped / std::max(1.0, 1.0 * unsat_core_num)) << " avg)\n";
+        }
+
+        out << "Solver caches (per thread, local/shared hits):";
+        {
+          const std::scoped_lock guard(solver_cache_stats_lock);
+          size_t t = 0;
+          for (auto& st : solver_cache_stats) {
+            auto n = std::max<uint64_t>(1, st.lookups.load());
+            out << " #" << t++ << " " << st.lookups << " lookups "
+                << (100.0 * st.local_hits / n) << "%/" << (100.0 * st.shared_hits / n) << "%;";
+          }
+        }
+        out << "\n";
+
+        out << "Abstract domain: "
+            << "#decided branches: " << absint_decided_branches << "; "
+            << "#avoided queries: " << absint_avoided_queries << "\n";
+
+        if (use_incremental) out << "Solver sessions: #reused path conditions: " << session_reused_conds << "\n";
+
+        if (solver_kind == SolverKind::portfolio) {
+          out << "Portfolio: #races: " << portfolio_races << " ("
+              << "STP wins: " << portfolio_stp_wins << "; "
+              << "Z3 wins: " << portfolio_z3_wins << "); "
+              << "#single backend: " << portfolio_single_queries << "\n";
+        }
+
+        if (use_persistent_query_cache) {
+          out << "Persistent cache: #hits: " << persistent_cache_hits << "; "
+              << "#written: " << persistent_cache_writes << "\n";
+        }
       }
       out << "[" << (ext_solver_time / 1.0e6) << "s/"
           << (int_solver_time / 1.0e6) << "s/"
@@ -155,6 +229,7 @@ struct Monitor {
       print_branch_cov(out);
       print_path_cov(out);
       print_thread_pool(out);
+      if (gc_threshold > 0) print_gc_stat(out);
       print_query_stat(out);
       if (done && print_cov_detail) {
         print_block_cov_detail(out);
@@ -175,6 +250,7 @@ struct Monitor {
           if (duration_cast<seconds>(now - start) > seconds(timeout)) {
             std::cout << "Timeout, aborting.\n";
             gs_log << "Timeout, aborting.\n";
+            flush_tests();
             stop = now;
             print_all(true);
             _exit(0);
@@ -0,0 +1,333 @@
+#ifndef GS_PERSISTENT_CACHE_HEADER
+#define GS_PERSISTENT_CACHE_HEADER
+
+#include <sys/file.h>
+#include <sys/mman.h>
+
+/* Query results kept on disk across runs */
+
+// The cache is an append-only file of records, each holding the fingerprint of
+// a constraint set, its result, and its model (by variable name) if it is
+// satisfiable. Fingerprints are computed from the structure of the terms and
+// the names of the variables, never from ids or addresses, so that the same
+// query of another run (or another process) finds the record. The file is
+// read through a memory mapping and indexed in memory; records appended by
+// other processes are picked up on a miss. Appends hold an exclusive flock
+// and readers scan under a shared one, so several processes can use the same
+// file; a record torn by a crash is cut off by the next append.
+
+// 128-bit fingerprint of a term or of a constraint set
+struct QueryKey {
+  uint64_t a = 0, b = 0;
+  bool operator==(const QueryKey& k) const { return a == k.a && b == k.b; }
+  bool operator<(const QueryKey& k) const { return a < k.a || (a == k.a && b < k.b); }
+};
+
+struct hash_QueryKey {
+  size_t operator()(const QueryKey& k) const { return k.a ^ (k.b * 0x9e3779b97f4a7c15ull); }
+};
+
+namespace persistent_key_impl {
+
+inline uint64_t fmix(uint64_t h) {
+  h ^= h >> 33; h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33; h *= 0xc4ceb9fe1a85ec53ull;
+  return h ^ (h >> 33);
+}
+
+// Folds `x` into both lanes, with different multipliers
+inline void mix(QueryKey& k, uint64_t x) {
+  k.a = fmix(k.a ^ (x * 0x87c37b91114253d5ull));
+  k.b = fmix(k.b + (x * 0x4cf5ad432745937full) + 0x52dce729ull);
+}
+
+inline void mix(QueryKey& k, const std::string& s) {
+  mix(k, s.size());
+  uint64_t w = 0;
+  for (size_t i = 0; i < s.size(); i++) {
+    w = (w << 8) | uint8_t(s[i]);
+    if (i % 8 == 7) { mix(k, w); w = 0; }
+  }
+  mix(k, w);
+}
+
+inline bool term(const PtrVal& v, QueryKey& out, phmap::flat_hash_map<uintptr_t, QueryKey>& memo) {
+  if (auto it = memo.find(v.bits()); it != memo.end()) { out = it->second; return true; }
+  QueryKey k { 0x243f6a8885a308d3ull, 0x13198a2e03707344ull };
+  if (v.is_unboxed()) {
+    mix(k, 1);
+    mix(k, unboxed_bw(v.bits()));
+    mix(k, uint64_t(unboxed_data(v.bits())));
+  } else if (v->kind == VKind::IntV) {
+    auto i = static_cast<const IntV*>(v.get());
+    mix(k, 1);
+    mix(k, i->bw);
+    mix(k, uint64_t(i->i));
+  } else if (v->kind == VKind::SymV) {
+    auto s = static_cast<const SymV*>(v.get());
+    if (!s->name.empty()) {
+      mix(k, 2);
+      mix(k, s->bw);
+      mix(k, s->name);
+    } else {
+      mix(k, 3);
+      mix(k, uint64_t(s->rator));
+      mix(k, s->bw);
+      mix(k, s->rands.size());
+      for (auto& r : s->rands) {
+        QueryKey rk;
+        if (!term(r, rk, memo)) return false;
+        mix(k, rk.a);
+        mix(k, rk.b);
+      }
+    }
+  } else {
+    // locations and floats are not stable across runs
+    return false;
+  }
+  memo.emplace(v.bits(), k);
+  out = k;
+  return true;
+}
+
+} // namespace persistent_key_impl
+
+// The fingerprint of a constraint set, false if it has terms that cannot be
+// identified across runs. The element fingerprints are sorted, so it does not
+// depend on the order of the set either.
+template <typename Set>
+inline bool persistent_key(const Set& conds, QueryKey& out) {
+  using namespace persistent_key_impl;
+  thread_local phmap::flat_hash_map<uintptr_t, QueryKey> memo;
+  thread_local std::vector<QueryKey> keys;
+  memo.clear();
+  keys.clear();
+  for (auto& c : conds) {
+    QueryKey k;
+    if (!term(c, k, memo)) return false;
+    keys.push_back(k);
+  }
+  std::sort(keys.begin(), keys.end());
+  out = { 0xa4093822299f31d0ull, 0x082efa98ec4e6c89ull };
+  mix(out, keys.size());
+  for (auto& k : keys) {
+    mix(out, k.a);
+    mix(out, k.b);
+  }
+  return true;
+}
+
+class PersistentCache {
+public:
+  struct Var {
+    std::string name;
+    uint32_t bw;
+    uint64_t value;
+  };
+  struct Entry {
+    solver_result result;
+    std::vector<Var> model;
+  };
+
+private:
+  static constexpr char file_magic[8] = { 'G', 'S', 'Q', 'C', 'A', 'C', 'H', 'E' };
+  // Note: version 1 caches hold results of the wrong division encodings
+  static constexpr uint32_t file_version = 2;
+  static constexpr size_t file_header_size = 16;
+  static constexpr uint32_t record_magic = 0x31524347; // "GCR1"
+  // Record layout (native byte order, 8-byte aligned):
+  //   u32 magic; u32 size (of the whole record); u64 key.a; u64 key.b;
+  //   u32 result; u32 number of vars;
+  //   per var: u32 bw; u32 length of name; u64 value; name, padded to 8;
+  //   u64 checksum of the bytes before it
+  static constexpr size_t record_header_size = 32;
+  static constexpr size_t var_header_size = 16;
+
+  std::mutex lock;
+  int fd = -1;
+  const char* base = nullptr;
+  size_t mapped = 0;
+  // The end of the valid records indexed so far
+  size_t scanned = file_header_size;
+  phmap::flat_hash_map<QueryKey, uint64_t, hash_QueryKey> index;
+  std::string path;
+
+  template <typename T>
+  static T load(const char* p) {
+    T x;
+    memcpy(&x, p, sizeof(T));
+    return x;
+  }
+  template <typename T>
+  static void store(std::string& buf, T x) {
+    buf.append(reinterpret_cast<const char*>(&x), sizeof(T));
+  }
+
+  static uint64_t checksum(const char* p, size_t n) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i + 8 <= n; i += 8) h = persistent_key_impl::fmix(h ^ load<uint64_t>(p + i));
+    return h;
+  }
+
+  static size_t padded(size_t n) { return (n + 7) & ~size_t(7); }
+
+  size_t file_size() {
+    struct stat st;
+    if (fstat(fd, &st) != 0) ABORT("Cannot stat the persistent query cache " << path);
+    return st.st_size;
+  }
+
+  void remap(size_t size) {
+    if (size == mapped) return;
+    if (base) munmap(const_cast<char*>(base), mapped);
+    void* p = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) ABORT("Cannot map the persistent query cache " << path);
+    base = static_cast<const char*>(p);
+    mapped = size;
+  }
+
+  // The size of the valid record at `off`, or 0 if it is torn or corrupt
+  size_t valid_record(size_t off) {
+    if (off + record_header_size + 8 > mapped) return 0;
+    auto p = base + off;
+    auto size = load<uint32_t>(p + 4);
+    if (load<uint32_t>(p) != record_magic || size % 8 != 0 ||
+        size < record_header_size + 8 || off + size > mapped) return 0;
+    if (checksum(p, size - 8) != load<uint64_t>(p + size - 8)) return 0;
+    return size;
+  }
+
+  // Indexes the records after `scanned`, up to the first invalid one.
+  // Note: the caller holds a flock on the file.
+  void scan() {
+    remap(file_size());
+    while (auto size = valid_record(scanned)) {
+      auto p = base + scanned;
+      QueryKey k { load<uint64_t>(p + 8), load<uint64_t>(p + 16) };
+      bool has_model = load<uint32_t>(p + 28) > 0;
+      // a satisfiable result without a model does not replace one with it
+      if (has_model || !index.count(k)) index[k] = scanned;
+      scanned += size;
+    }
+  }
+
+  void refresh() {
+    if (file_size() == scanned) return;
+    flock(fd, LOCK_SH);
+    scan();
+    flock(fd, LOCK_UN);
+  }
+
+  Entry parse(size_t off) {
+    auto p = base + off;
+    Entry e;
+    e.result = solver_result(load<uint32_t>(p + 24));
+    auto n = load<uint32_t>(p + 28);
+    e.model.reserve(n);
+    p += record_header_size;
+    for (uint32_t i = 0; i < n; i++) {
+      auto len = load<uint32_t>(p + 4);
+      e.model.push_back({ std::string(p + var_header_size, len), load<uint32_t>(p), load<uint64_t>(p + 8) });
+      p += var_header_size + padded(len);
+    }
+    return e;
+  }
+
+public:
+  ~PersistentCache() { close(); }
+
+  bool is_open() const { return fd >= 0; }
+  const std::string& file() const { return path; }
+
+  void open(const std::string& p) {
+    const std::scoped_lock guard(lock);
+    ASSERT(fd < 0, "The persistent query cache is open already");
+    path = p;
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+    if (fd < 0) ABORT("Cannot open the persistent query cache " << path);
+    flock(fd, LOCK_EX);
+    if (file_size() == 0) {
+      std::string buf(file_magic, sizeof(file_magic));
+      store<uint32_t>(buf, file_version);
+      store<uint32_t>(buf, 0);
+      if (write(fd, buf.data(), buf.size()) != ssize_t(buf.size()))
+        ABORT("Cannot write the persistent query cache " << path);
+    }
+    remap(file_size());
+    bool ok = mapped >= file_header_size && memcmp(base, file_magic, sizeof(file_magic)) == 0 &&
+              load<uint32_t>(base + 8) == file_version;
+    if (ok) scan();
+    flock(fd, LOCK_UN);
+    if (!ok) ABORT(path << " is not a persistent query cache of this version");
+  }
+
+  void close() {
+    const std::scoped_lock guard(lock);
+    if (base) munmap(const_cast<char*>(base), mapped);
+    if (fd >= 0) ::close(fd);
+    base = nullptr;
+    mapped = 0;
+    fd = -1;
+    scanned = file_header_size;
+    index.clear();
+  }
+
+  size_t size() {
+    const std::scoped_lock guard(lock);
+    return index.size();
+  }
+
+  bool find(const QueryKey& k, Entry& e) {
+    const std::scoped_lock guard(lock);
+    if (fd < 0) return false;
+    auto it = index.find(k);
+    if (it == index.end()) {
+      refresh();
+      if ((it = index.find(k)) == index.end()) return false;
+    }
+    e = parse(it->second);
+    return true;
+  }
+
+  void insert(const QueryKey& k, solver_result res, const std::vector<Var>& model = {}) {
+    std::string buf;
+    store<uint32_t>(buf, record_magic);
+    store<uint32_t>(buf, 0);
+    store<uint64_t>(buf, k.a);
+    store<uint64_t>(buf, k.b);
+    store<uint32_t>(buf, res);
+    store<uint32_t>(buf, model.size());
+    for (auto& v : model) {
+      store<uint32_t>(buf, v.bw);
+      store<uint32_t>(buf, v.name.size());
+      store<uint64_t>(buf, v.value);
+      buf += v.name;
+      buf.resize(padded(buf.size()), '\0');
+    }
+    uint32_t size = buf.size() + 8;
+    memcpy(&buf[4], &size, sizeof(size));
+    store<uint64_t>(buf, checksum(buf.data(), buf.size()));
+
+    const std::scoped_lock guard(lock);
+    if (fd < 0) return;
+    if (auto it = index.find(k); it != index.end() && (model.empty() || load<uint32_t>(base + it->second + 28) > 0)) return;
+    flock(fd, LOCK_EX);
+    scan();
+    // a torn record (of a crashed process) at the end would hide the new one
+    bool ok = scanned == mapped || ftruncate(fd, scanned) == 0;
+    // Note: a failed write (e.g. a full disk) only loses this record
+    if (ok && write(fd, buf.data(), buf.size()) == ssize_t(buf.size())) {
+      index[k] = scanned;
+      scanned += buf.size();
+      persistent_cache_writes++;
+    }
+    remap(file_size());
+    flock(fd, LOCK_UN);
+  }
+};
+
+inline PersistentCache persistent_cache;
+
+inline bool use_persistent_cache() { return persistent_cache.is_open(); }
+
+#endif
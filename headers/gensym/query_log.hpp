@@ -0,0 +1,213 @@
+#ifndef GS_QUERY_LOG_HEADER
+#define GS_QUERY_LOG_HEADER
+
+/* Logs of solver queries, for replaying them offline */
+
+// With --dump-queries, every query that reaches a solver is appended to
+// queries.bin in the output folder: the constraint set as a DAG, what the
+// query was for, its result and its latency. headers/test/replay_queries
+// feeds such a log to a checker, so that backends and caches can be compared
+// on the same queries without running the symbolic execution again.
+// A query checked in the solver session of a path (--solver-incremental) is
+// logged as the whole session, as solved and timed, and flagged as such.
+
+enum class QueryKind : uint8_t { branch, concretize, test_gen };
+
+inline const char* query_kind_name(QueryKind k) {
+  switch (k) {
+    case QueryKind::branch: return "branch";
+    case QueryKind::concretize: return "concretize";
+    case QueryKind::test_gen: return "test-gen";
+    default: ABORT("unknown query kind");
+  }
+}
+
+// File layout (native byte order): the magic "GSQLOG01", then per query
+//   u32 size (of the whole record); u8 kind; u8 result; u8 flags; u8 0;
+//   u32 number of nodes; u32 number of roots; u64 latency (us);
+//   per node, operands first: u8 tag (0 constant, 1 variable, 2 operation);
+//     u8 operator; u16 bw; u32 n (name length or number of operands);
+//     then a u64 constant, the name, or the u32 indices of the operands;
+//   u32 index of each root (a constraint of the set)
+struct QueryLogFormat {
+  static constexpr char magic[8] = { 'G', 'S', 'Q', 'L', 'O', 'G', '0', '1' };
+  static constexpr size_t record_header_size = 24;
+  enum : uint8_t { Const = 0, Var = 1, Op = 2 };
+  // Flags of a query
+  enum : uint8_t { Session = 1 };
+};
+
+class QueryLog {
+  std::mutex lock;
+  int fd = -1;
+  uint64_t num_records = 0;
+
+  template <typename T>
+  static void store(std::string& buf, T x) {
+    buf.append(reinterpret_cast<const char*>(&x), sizeof(T));
+  }
+
+  // Appends the node of `v` (after its operands) to `buf`, returns its index
+  // or -1 if it is not a bitvector term
+  static int64_t node(std::string& buf, const PtrVal& v, phmap::flat_hash_map<uintptr_t, uint32_t>& ids) {
+    if (auto it = ids.find(v.bits()); it != ids.end()) return it->second;
+    auto bw = bw_of(v);
+    if (bw == 0 || bw > 0xffff) return -1;
+    if (v.is_unboxed() || v->kind == VKind::IntV) {
+      auto d = dom_of(v);
+      if (!d.is_const()) return -1;
+      store<uint8_t>(buf, QueryLogFormat::Const);
+      store<uint8_t>(buf, 0);
+      store<uint16_t>(buf, bw);
+      store<uint32_t>(buf, 0);
+      store<uint64_t>(buf, d.lo);
+    } else if (v->kind != VKind::SymV) {
+      return -1;
+    } else if (auto s = static_cast<const SymV*>(v.get()); !s->name.empty()) {
+      store<uint8_t>(buf, QueryLogFormat::Var);
+      store<uint8_t>(buf, 0);
+      store<uint16_t>(buf, bw);
+      store<uint32_t>(buf, s->name.size());
+      buf += s->name;
+    } else {
+      std::vector<uint32_t> rands;
+      for (auto& r : s->rands) {
+        auto i = node(buf, r, ids);
+        if (i < 0) return -1;
+        rands.push_back(i);
+      }
+      store<uint8_t>(buf, QueryLogFormat::Op);
+      store<uint8_t>(buf, uint8_t(s->rator));
+      store<uint16_t>(buf, bw);
+      store<uint32_t>(buf, rands.size());
+      for (auto i : rands) store<uint32_t>(buf, i);
+    }
+    uint32_t id = ids.size();
+    ids.emplace(v.bits(), id);
+    return id;
+  }
+
+public:
+  ~QueryLog() { close(); }
+
+  bool is_open() const { return fd >= 0; }
+  uint64_t size() const { return num_records; }
+
+  void open(const std::string& path) {
+    const std::scoped_lock guard(lock);
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0666);
+    if (fd < 0) ABORT("Cannot open the query log " << path);
+    if (write(fd, QueryLogFormat::magic, sizeof(QueryLogFormat::magic)) != sizeof(QueryLogFormat::magic))
+      ABORT("Cannot write the query log " << path);
+  }
+
+  void close() {
+    const std::scoped_lock guard(lock);
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+  }
+
+  // Note: each record is written at once, so that the log is complete up to
+  // the last query even if the process is killed (e.g. on timeout)
+  template <typename Set>
+  void record(QueryKind kind, const Set& conds, solver_result res, uint64_t latency_us, uint8_t flags = 0) {
+    thread_local std::string buf;
+    thread_local phmap::flat_hash_map<uintptr_t, uint32_t> ids;
+    buf.assign(QueryLogFormat::record_header_size, '\0');
+    ids.clear();
+    std::vector<uint32_t> roots;
+    for (auto& c : conds) {
+      auto i = node(buf, c, ids);
+      if (i < 0) return;
+      roots.push_back(i);
+    }
+    for (auto i : roots) store<uint32_t>(buf, i);
+    uint32_t size = buf.size(), num_nodes = ids.size(), num_roots = roots.size();
+    uint8_t k = uint8_t(kind), r = uint8_t(res);
+    memcpy(&buf[0], &size, 4);
+    memcpy(&buf[4], &k, 1);
+    memcpy(&buf[5], &r, 1);
+    memcpy(&buf[6], &flags, 1);
+    memcpy(&buf[8], &num_nodes, 4);
+    memcpy(&buf[12], &num_roots, 4);
+    memcpy(&buf[16], &latency_us, 8);
+    const std::scoped_lock guard(lock);
+    if (fd < 0) return;
+    if (write(fd, buf.data(), buf.size()) == ssize_t(buf.size())) num_records++;
+  }
+};
+
+inline QueryLog query_log;
+
+inline bool use_query_log() { return query_log.is_open(); }
+
+// Reads the queries of a log back as values
+class QueryLogReader {
+  std::string data;
+  size_t pos = sizeof(QueryLogFormat::magic);
+
+  template <typename T>
+  T load(size_t off) const {
+    T x;
+    memcpy(&x, data.data() + off, sizeof(T));
+    return x;
+  }
+
+public:
+  struct Query {
+    QueryKind kind;
+    solver_result result;
+    uint8_t flags;
+    uint64_t latency_us;
+    std::vector<PtrVal> conds;
+  };
+
+  explicit QueryLogReader(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) ABORT("Cannot open the query log " << path);
+    data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    if (data.size() < sizeof(QueryLogFormat::magic) ||
+        memcmp(data.data(), QueryLogFormat::magic, sizeof(QueryLogFormat::magic)) != 0)
+      ABORT(path << " is not a query log");
+  }
+
+  // Reads the next query, false at the end of the log (or at a torn record)
+  bool next(Query& q) {
+    if (pos + QueryLogFormat::record_header_size > data.size()) return false;
+    auto size = load<uint32_t>(pos);
+    if (size < QueryLogFormat::record_header_size || pos + size > data.size()) return false;
+    q.kind = QueryKind(load<uint8_t>(pos + 4));
+    q.result = solver_result(load<uint8_t>(pos + 5));
+    q.flags = load<uint8_t>(pos + 6);
+    auto num_nodes = load<uint32_t>(pos + 8), num_roots = load<uint32_t>(pos + 12);
+    q.latency_us = load<uint64_t>(pos + 16);
+    std::vector<PtrVal> nodes;
+    nodes.reserve(num_nodes);
+    size_t p = pos + QueryLogFormat::record_header_size;
+    for (uint32_t i = 0; i < num_nodes; i++) {
+      auto tag = load<uint8_t>(p);
+      auto rator = iOP(load<uint8_t>(p + 1));
+      size_t bw = load<uint16_t>(p + 2);
+      auto n = load<uint32_t>(p + 4);
+      p += 8;
+      if (tag == QueryLogFormat::Const) {
+        nodes.push_back(make_IntV(load<uint64_t>(p), bw));
+        p += 8;
+      } else if (tag == QueryLogFormat::Var) {
+        nodes.push_back(make_SymV(data.substr(p, n), bw));
+        p += n;
+      } else {
+        std::vector<PtrVal> rands;
+        for (uint32_t j = 0; j < n; j++) rands.push_back(nodes[load<uint32_t>(p + 4 * j)]);
+        nodes.push_back(make_SymV(rator, immer::array<PtrVal>(rands.begin(), rands.end()), bw));
+        p += 4 * n;
+      }
+    }
+    q.conds.clear();
+    for (uint32_t i = 0; i < num_roots; i++) q.conds.push_back(nodes[load<uint32_t>(p + 4 * i)]);
+    pos += size;
+    return true;
+  }
+};
+
+#endif
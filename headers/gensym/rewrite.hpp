@@ -0,0 +1,414 @@
+#ifndef GS_REWRITE_HEADER
+#define GS_REWRITE_HEADER
+
+/* Term rewriting of symbolic expressions */
+
+// make_SymV tries the rules below before constructing an operator node.
+// A rule builds its result with the usual constructors (int_op_2, bv_extract,
+// ite, ...), which rewrite again, so terms are normalized bottom-up until no
+// rule applies. The number of rule applications triggered by constructing a
+// single node is bounded by `rewrite_budget`; once it is exhausted, nodes are
+// constructed as they are.
+// Note: nodes in the hash-consing pool are already in normal form (modulo an
+// exhausted budget), which is why make_SymV looks up the pool first.
+
+namespace rewrite {
+
+struct Context {
+  unsigned depth = 0;
+  unsigned steps = 0;
+};
+
+inline thread_local Context ctx;
+
+inline void hit(RewriteRule r) {
+  rewrite_hits[size_t(r)].fetch_add(1, std::memory_order_relaxed);
+  ctx.steps++;
+}
+
+// The (MSB-aligned) data of a concrete integer
+inline bool conc_data(const PtrVal& v, IntData& d) {
+  if (v.is_unboxed()) {
+    d = unboxed_data(v.bits());
+    return true;
+  }
+  if (v.get()->kind != VKind::IntV) return false;
+  d = static_cast<const IntV*>(v.get())->i;
+  return true;
+}
+
+inline bool is_conc(const PtrVal& v) {
+  IntData d;
+  return conc_data(v, d);
+}
+
+inline bool is_zero(const PtrVal& v) {
+  IntData d;
+  return conc_data(v, d) && d == 0;
+}
+
+inline bool is_one(const PtrVal& v, size_t bw) {
+  IntData d;
+  return conc_data(v, d) && uint64_t(d) == (uint64_t(1) << (addr_bw - bw));
+}
+
+inline bool is_ones(const PtrVal& v, size_t bw) {
+  IntData d;
+  return conc_data(v, d) && uint64_t(d) == (~uint64_t(0) << (addr_bw - bw));
+}
+
+// The operator node `v` if its operator is `op`, otherwise nullptr
+inline const SymV* as_op(const PtrVal& v, iOP op) {
+  if (v.is_unboxed() || v.get()->kind != VKind::SymV) return nullptr;
+  auto s = static_cast<const SymV*>(v.get());
+  return (s->name.empty() && s->rator == op) ? s : nullptr;
+}
+
+inline int extract_hi(const SymV* e) { return proj_IntV(e->rands[1]); }
+inline int extract_lo(const SymV* e) { return proj_IntV(e->rands[2]); }
+
+inline bool is_cmp(iOP op) {
+  switch (op) {
+    case iOP::op_eq: case iOP::op_neq:
+    case iOP::op_uge: case iOP::op_ugt: case iOP::op_ule: case iOP::op_ult:
+    case iOP::op_sge: case iOP::op_sgt: case iOP::op_sle: case iOP::op_slt:
+      return true;
+    default: return false;
+  }
+}
+
+inline iOP negate_cmp(iOP op) {
+  switch (op) {
+    case iOP::op_eq:  return iOP::op_neq;
+    case iOP::op_neq: return iOP::op_eq;
+    case iOP::op_uge: return iOP::op_ult;
+    case iOP::op_ugt: return iOP::op_ule;
+    case iOP::op_ule: return iOP::op_ugt;
+    case iOP::op_ult: return iOP::op_uge;
+    case iOP::op_sge: return iOP::op_slt;
+    case iOP::op_sgt: return iOP::op_sle;
+    case iOP::op_sle: return iOP::op_sgt;
+    case iOP::op_slt: return iOP::op_sge;
+    default: ABORT("Not a comparison");
+  }
+}
+
+inline bool is_commutative(iOP op) {
+  switch (op) {
+    case iOP::op_add: case iOP::op_mul:
+    case iOP::op_and: case iOP::op_or: case iOP::op_xor:
+    case iOP::op_eq: case iOP::op_neq:
+      return true;
+    default: return false;
+  }
+}
+
+// Joins extract(x, h, m) (the high part) and extract(x, m-1, l) into
+// extract(x, h, l), if `hi` and `lo` are such extracts.
+inline PtrVal fuse_extracts(const PtrVal& hi, const PtrVal& lo) {
+  auto e1 = as_op(hi, iOP::op_extract);
+  auto e2 = as_op(lo, iOP::op_extract);
+  if (!e1 || !e2 || e1->rands[0] != e2->rands[0]) return nullptr;
+  if (extract_lo(e1) != extract_hi(e2) + 1) return nullptr;
+  return bv_extract(e1->rands[0], extract_hi(e1), extract_lo(e2));
+}
+
+inline PtrVal rewrite_unary(iOP op, const PtrVal& a, size_t bw) {
+  if (is_conc(a)) {
+    hit(RewriteRule::const_fold);
+    switch (op) {
+      case iOP::op_sext: case iOP::op_zext: return int_op_1(op, a, { bw });
+      case iOP::op_trunc: return int_op_1(op, a, { bw_of(a), bw });
+      default: return int_op_1(op, a);
+    }
+  }
+  switch (op) {
+    case iOP::op_neg: {
+      if (auto n = as_op(a, iOP::op_neg)) {
+        hit(RewriteRule::double_neg);
+        return n->rands[0];
+      }
+      if (a.get()->kind != VKind::SymV) break;
+      auto s = static_cast<const SymV*>(a.get());
+      if (s->name.empty() && is_cmp(s->rator)) {
+        hit(RewriteRule::neg_cmp);
+        return int_op_2(negate_cmp(s->rator), s->rands[0], s->rands[1]);
+      }
+      break;
+    }
+    case iOP::op_bvnot:
+      if (auto n = as_op(a, iOP::op_bvnot)) {
+        hit(RewriteRule::double_neg);
+        return n->rands[0];
+      }
+      break;
+    case iOP::op_zext:
+      if (auto z = as_op(a, iOP::op_zext)) {
+        hit(RewriteRule::ext_ext);
+        return bv_zext(z->rands[0], bw);
+      }
+      break;
+    case iOP::op_sext:
+      if (auto s = as_op(a, iOP::op_sext)) {
+        hit(RewriteRule::ext_ext);
+        return bv_sext(s->rands[0], bw);
+      }
+      // the sign bit of a (strict) zero extension is zero
+      if (auto z = as_op(a, iOP::op_zext)) {
+        hit(RewriteRule::ext_ext);
+        return bv_zext(z->rands[0], bw);
+      }
+      break;
+    case iOP::op_trunc: {
+      auto e = as_op(a, iOP::op_zext);
+      if (!e) e = as_op(a, iOP::op_sext);
+      if (!e) break;
+      hit(RewriteRule::trunc_ext);
+      auto& x = e->rands[0];
+      auto bwx = bw_of(x);
+      if (bw == bwx) return x;
+      if (bw < bwx) return trunc(x, bwx, bw);
+      return e->rator == iOP::op_zext ? bv_zext(x, bw) : bv_sext(x, bw);
+    }
+    default: break;
+  }
+  return nullptr;
+}
+
+// `ext(x) op c` where ext is a zero/sign extension, and c fits in the width
+// of x, is rewritten to `x op c'`
+inline PtrVal rewrite_ext_cmp(iOP op, const SymV* ext, const PtrVal& c, size_t bw) {
+  auto& x = ext->rands[0];
+  auto bwx = bw_of(x);
+  IntData d;
+  conc_data(c, d);
+  if (ext->rator == iOP::op_zext) {
+    auto u = uint64_t(d) >> (addr_bw - bw);
+    hit(RewriteRule::ext_cmp);
+    // c is out of the range of the extension
+    if (u >> bwx) return make_IntV(op == iOP::op_neq, 1);
+    return int_op_2(op, x, make_IntV(u, bwx));
+  }
+  auto s = int64_t(d) >> (addr_bw - bw);
+  auto half = int64_t(1) << (bwx - 1);
+  hit(RewriteRule::ext_cmp);
+  if (s < -half || half <= s) return make_IntV(op == iOP::op_neq, 1);
+  return int_op_2(op, x, make_IntV(s, bwx));
+}
+
+inline PtrVal rewrite_binary(iOP op, const PtrVal& a, const PtrVal& b, size_t bw) {
+  bool ca = is_conc(a), cb = is_conc(b);
+  if (ca && cb) {
+    switch (op) {
+      case iOP::op_sdiv: case iOP::op_udiv:
+      case iOP::op_srem: case iOP::op_urem:
+        return nullptr;
+      default:
+        hit(RewriteRule::const_fold);
+        return int_op_2(op, a, b);
+    }
+  }
+  // constants go to the right of commutative operators
+  if (ca && is_commutative(op)) {
+    hit(RewriteRule::commute);
+    return int_op_2(op, b, a);
+  }
+  if (a == b) {
+    switch (op) {
+      case iOP::op_sub: case iOP::op_xor:
+        hit(RewriteRule::self_op);
+        return make_IntV(0, bw);
+      case iOP::op_and: case iOP::op_or:
+        hit(RewriteRule::self_op);
+        return a;
+      case iOP::op_eq: case iOP::op_uge: case iOP::op_ule:
+      case iOP::op_sge: case iOP::op_sle:
+        hit(RewriteRule::self_op);
+        return make_IntV(1, 1);
+      case iOP::op_neq: case iOP::op_ugt: case iOP::op_ult:
+      case iOP::op_sgt: case iOP::op_slt:
+        hit(RewriteRule::self_op);
+        return make_IntV(0, 1);
+      default: break;
+    }
+  }
+  if (op == iOP::op_concat) {
+    if (auto f = fuse_extracts(a, b)) {
+      hit(RewriteRule::concat_fuse);
+      return f;
+    }
+    if (auto c = as_op(b, iOP::op_concat)) {
+      if (auto f = fuse_extracts(a, c->rands[0])) {
+        hit(RewriteRule::concat_fuse);
+        return int_op_2(iOP::op_concat, f, c->rands[1]);
+      }
+    }
+    if (auto c = as_op(a, iOP::op_concat)) {
+      if (auto f = fuse_extracts(c->rands[1], b)) {
+        hit(RewriteRule::concat_fuse);
+        return int_op_2(iOP::op_concat, c->rands[0], f);
+      }
+    }
+    return nullptr;
+  }
+  if (!cb) return nullptr;
+  auto bwa = bw_of(a);
+  switch (op) {
+    case iOP::op_add: case iOP::op_sub: case iOP::op_or: case iOP::op_xor:
+    case iOP::op_shl: case iOP::op_lshr: case iOP::op_ashr:
+      if (is_zero(b)) { hit(RewriteRule::identity); return a; }
+      break;
+    case iOP::op_mul:
+      if (is_one(b, bwa)) { hit(RewriteRule::identity); return a; }
+      if (is_zero(b)) { hit(RewriteRule::annihilate); return b; }
+      break;
+    case iOP::op_sdiv: case iOP::op_udiv:
+      if (is_one(b, bwa)) { hit(RewriteRule::identity); return a; }
+      break;
+    case iOP::op_and:
+      if (is_ones(b, bwa)) { hit(RewriteRule::identity); return a; }
+      if (is_zero(b)) { hit(RewriteRule::annihilate); return b; }
+      break;
+    default: break;
+  }
+  if (op == iOP::op_or && is_ones(b, bwa)) {
+    hit(RewriteRule::annihilate);
+    return b;
+  }
+  // x - c => x + (-c), so that constant chains only involve additions
+  if (op == iOP::op_sub) {
+    hit(RewriteRule::sub_const);
+    return int_op_2(iOP::op_add, a, int_op_2(iOP::op_sub, make_IntV(0, bwa), b));
+  }
+  // (x op c1) op c2 => x op (c1 op c2), for associative operators
+  switch (op) {
+    case iOP::op_add: case iOP::op_mul:
+    case iOP::op_and: case iOP::op_or: case iOP::op_xor:
+      if (auto s = as_op(a, op)) {
+        if (is_conc(s->rands[1])) {
+          hit(RewriteRule::const_chain);
+          return int_op_2(op, s->rands[0], int_op_2(op, s->rands[1], b));
+        }
+      }
+      break;
+    case iOP::op_eq: case iOP::op_neq:
+      // (x + c1) == c2 => x == c2 - c1
+      if (auto s = as_op(a, iOP::op_add)) {
+        if (is_conc(s->rands[1])) {
+          hit(RewriteRule::const_chain);
+          return int_op_2(op, s->rands[0], int_op_2(iOP::op_sub, b, s->rands[1]));
+        }
+      }
+      if (auto e = as_op(a, iOP::op_zext)) return rewrite_ext_cmp(op, e, b, bw_of(a));
+      if (auto e = as_op(a, iOP::op_sext)) return rewrite_ext_cmp(op, e, b, bw_of(a));
+      break;
+    default: break;
+  }
+  return nullptr;
+}
+
+inline PtrVal rewrite_extract(const PtrVal& src, int hi, int lo) {
+  if (is_conc(src)) {
+    hit(RewriteRule::const_fold);
+    return bv_extract(src, hi, lo);
+  }
+  if (lo == 0 && hi + 1 == int(bw_of(src))) {
+    hit(RewriteRule::extract_full);
+    return src;
+  }
+  if (auto e = as_op(src, iOP::op_extract)) {
+    hit(RewriteRule::extract_extract);
+    auto base = extract_lo(e);
+    return bv_extract(e->rands[0], base + hi, base + lo);
+  }
+  if (auto c = as_op(src, iOP::op_concat)) {
+    int bwl = bw_of(c->rands[1]);
+    if (hi < bwl) {
+      hit(RewriteRule::extract_concat);
+      return bv_extract(c->rands[1], hi, lo);
+    }
+    if (lo >= bwl) {
+      hit(RewriteRule::extract_concat);
+      return bv_extract(c->rands[0], hi - bwl, lo - bwl);
+    }
+    return nullptr;
+  }
+  auto e = as_op(src, iOP::op_zext);
+  if (!e) e = as_op(src, iOP::op_sext);
+  if (!e) e = as_op(src, iOP::op_trunc);
+  if (e) {
+    int bwx = bw_of(e->rands[0]);
+    if (hi < bwx) {
+      hit(RewriteRule::extract_ext);
+      return bv_extract(e->rands[0], hi, lo);
+    }
+    if (e->rator == iOP::op_zext && lo >= bwx) {
+      hit(RewriteRule::extract_ext);
+      return make_IntV(0, hi - lo + 1);
+    }
+  }
+  return nullptr;
+}
+
+inline PtrVal rewrite_ite(const PtrVal& c, const PtrVal& a, const PtrVal& b, size_t bw) {
+  if (is_conc(c)) {
+    hit(RewriteRule::const_fold);
+    return ite(c, a, b);
+  }
+  if (a == b) {
+    hit(RewriteRule::ite_same);
+    return a;
+  }
+  if (auto n = as_op(c, iOP::op_neg)) {
+    hit(RewriteRule::ite_neg);
+    return ite(n->rands[0], b, a);
+  }
+  if (bw == 1 && is_conc(a) && is_conc(b)) {
+    hit(RewriteRule::ite_bool);
+    return is_zero(b) ? c : SymV::neg(c);
+  }
+  if (auto t = as_op(a, iOP::op_ite)) {
+    if (t->rands[0] == c) {
+      hit(RewriteRule::ite_nested);
+      return ite(c, t->rands[1], b);
+    }
+  }
+  if (auto e = as_op(b, iOP::op_ite)) {
+    if (e->rands[0] == c) {
+      hit(RewriteRule::ite_nested);
+      return ite(c, a, e->rands[2]);
+    }
+  }
+  return nullptr;
+}
+
+inline PtrVal apply(iOP op, const PtrVal* rands, size_t n, size_t bw) {
+  // arrays are kept as they are, see make_object_array
+  if (op == iOP::op_array || op == iOP::op_select) return nullptr;
+  switch (n) {
+    case 1: return rewrite_unary(op, rands[0], bw);
+    case 2: return rewrite_binary(op, rands[0], rands[1], bw);
+    case 3:
+      if (op == iOP::op_extract)
+        return rewrite_extract(rands[0], proj_IntV(rands[1]), proj_IntV(rands[2]));
+      if (op == iOP::op_ite) return rewrite_ite(rands[0], rands[1], rands[2], bw);
+      return nullptr;
+    default: return nullptr;
+  }
+}
+
+} // namespace rewrite
+
+// Returns the normal form of the operator node, or nullptr if no rule applies
+// (or the budget is exhausted).
+inline PtrVal rewrite_SymV(iOP rator, const PtrVal* rands, size_t n, size_t bw) {
+  auto& ctx = rewrite::ctx;
+  if (ctx.depth == 0) ctx.steps = 0;
+  else if (ctx.steps >= rewrite_budget) return nullptr;
+  ctx.depth++;
+  auto ret = rewrite::apply(rator, rands, n, bw);
+  ctx.depth--;
+  return ret;
+}
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef GS_SETTRIE_HEADER
+#define GS_SETTRIE_HEADER
+
+/* A set-trie (UBTree) of constraint sets */
+
+// Maximum number of nodes visited by one search
+inline constexpr size_t settrie_budget = 4096;
+
+// Stores constraint sets as paths of their (sorted) elements, each set with
+// a value (e.g. its model, or none if it is unsatisfiable), and answers the
+// queries of a counterexample cache: is there a stored subset (or superset)
+// of a given set. A subset of a satisfiable set is satisfiable by the same
+// model, and a superset of an unsatisfiable set is unsatisfiable.
+template <typename V>
+class SetTrie {
+  struct Node {
+    // sorted by the address of the element
+    std::vector<std::pair<uintptr_t, std::unique_ptr<Node>>> children;
+    bool end = false;
+    V value{};
+
+    Node* child(uintptr_t k) const {
+      auto it = std::lower_bound(children.begin(), children.end(), k,
+                                 [](auto& c, uintptr_t k) { return c.first < k; });
+      return (it != children.end() && it->first == k) ? it->second.get() : nullptr;
+    }
+    Node* add_child(uintptr_t k) {
+      auto it = std::lower_bound(children.begin(), children.end(), k,
+                                 [](auto& c, uintptr_t k) { return c.first < k; });
+      if (it != children.end() && it->first == k) return it->second.get();
+      return children.insert(it, { k, std::make_unique<Node>() })->second.get();
+    }
+  };
+
+  Node root;
+  size_t count = 0;
+
+  // Visits the nodes of stored subsets of q[0..n), until `f` returns true
+  template <typename F>
+  bool subsets(const Node* node, const PtrVal* q, size_t n, size_t& budget, F& f) const {
+    if (budget == 0) return false;
+    budget--;
+    if (node->end && f(node->value)) return true;
+    for (size_t i = 0; i < n && !node->children.empty(); i++) {
+      if (auto c = node->child(q[i].bits())) {
+        if (subsets(c, q + i + 1, n - i - 1, budget, f)) return true;
+      }
+    }
+    return false;
+  }
+
+  // Visits the nodes of stored supersets of q[0..n), until `f` returns true
+  template <typename F>
+  bool supersets(const Node* node, const PtrVal* q, size_t n, size_t& budget, F& f) const {
+    if (budget == 0) return false;
+    budget--;
+    if (n == 0 && node->end && f(node->value)) return true;
+    for (auto& [k, c] : node->children) {
+      if (n > 0 && k > q[0].bits()) break;
+      if (n > 0 && k == q[0].bits()) {
+        if (supersets(c.get(), q + 1, n - 1, budget, f)) return true;
+      } else if (supersets(c.get(), q, n, budget, f)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  template <typename F>
+  void for_each(const Node* node, std::vector<PtrVal>& path, F& f) const {
+    if (node->end) f(path, node->value);
+    for (auto& [k, c] : node->children) {
+      path.push_back(PtrVal::from_bits(k));
+      for_each(c.get(), path, f);
+      path.pop_back();
+    }
+  }
+
+public:
+  template <typename Set>
+  void insert(const Set& s, const V& v) {
+    Node* node = &root;
+    for (auto& e : s) node = node->add_child(e.bits());
+    if (!node->end) count++;
+    node->end = true;
+    node->value = v;
+  }
+
+  // Finds a stored subset of `s` whose value satisfies `f`
+  template <typename Set, typename F>
+  bool find_subset(const Set& s, F f) const {
+    std::vector<PtrVal> q(s.begin(), s.end());
+    size_t budget = settrie_budget;
+    return subsets(&root, q.data(), q.size(), budget, f);
+  }
+
+  // Finds a stored superset of `s` whose value satisfies `f`
+  template <typename Set, typename F>
+  bool find_superset(const Set& s, F f) const {
+    std::vector<PtrVal> q(s.begin(), s.end());
+    size_t budget = settrie_budget;
+    return supersets(&root, q.data(), q.size(), budget, f);
+  }
+
+  size_t size() const { return count; }
+
+  // Drops the sets that fail `keep`
+  template <typename F>
+  void retain(F keep) {
+    SetTrie kept;
+    std::vector<PtrVal> path;
+    auto f = [&](const std::vector<PtrVal>& s, const V& v) { if (keep(s)) kept.insert(s, v); };
+    for_each(&root, path, f);
+    root.children = std::move(kept.root.children);
+    root.end = kept.root.end;
+    root.value = kept.root.value;
+    count = kept.count;
+  }
+
+  void clear() { retain([](auto&) { return false; }); }
+};
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef GS_SHARED_CACHE_HEADER
+#define GS_SHARED_CACHE_HEADER
+
+/* Solver caches shared by all threads */
+
+// Each checker (one per thread) keeps its own caches of query results and
+// models, and consults a SharedCache before calling the solver, so that a
+// constraint set solved by one thread is not solved again by another. Keys are
+// sets of hash-consed values, which are equal across threads. The cache is
+// split into independently locked shards; a shard evicts its least recently
+// used entries once their (estimated) size exceeds its part of the budget.
+template <typename K, typename V, typename H>
+class SharedCache {
+  static constexpr size_t num_shards = 64;
+  struct Entry {
+    K key;
+    V value;
+    size_t cost;
+  };
+  using LRU = std::list<Entry>;
+
+  // The index refers to the keys stored in the LRU list
+  struct hash_key {
+    using is_transparent = void;
+    size_t operator()(const K* k) const { return H{}(*k); }
+    size_t operator()(const K& k) const { return H{}(k); }
+  };
+  struct equal_key {
+    using is_transparent = void;
+    bool operator()(const K* a, const K* b) const { return *a == *b; }
+    bool operator()(const K* a, const K& b) const { return *a == b; }
+    bool operator()(const K& a, const K* b) const { return a == *b; }
+  };
+
+  struct alignas(64) Shard {
+    std::mutex lock;
+    LRU lru; // the most recently used first
+    phmap::flat_hash_map<const K*, typename LRU::iterator, hash_key, equal_key> index;
+    size_t bytes = 0;
+  };
+  Shard shards[num_shards];
+  // The part of `shared_cache_mb` used by this cache, in percent
+  size_t share;
+
+  Shard& shard_of(const K& k) {
+    return shards[(uint64_t(H{}(k)) * 0x9E3779B97F4A7C15ull) >> 58];
+  }
+  size_t shard_budget() const { return (size_t(shared_cache_mb) << 20) / 100 * share / num_shards; }
+
+public:
+  explicit SharedCache(size_t share) : share(share) {}
+
+  bool find(const K& k, V& out) {
+    auto& s = shard_of(k);
+    const std::scoped_lock guard(s.lock);
+    auto it = s.index.find(k);
+    if (it == s.index.end()) return false;
+    s.lru.splice(s.lru.begin(), s.lru, it->second);
+    out = it->second->value;
+    return true;
+  }
+
+  // Note: an existing entry is kept, both come from the same query.
+  void insert(const K& k, const V& v, size_t cost) {
+    auto& s = shard_of(k);
+    const std::scoped_lock guard(s.lock);
+    if (s.index.find(k) != s.index.end()) return;
+    s.lru.push_front(Entry{k, v, cost});
+    s.index.emplace(&s.lru.front().key, s.lru.begin());
+    s.bytes += cost;
+    auto budget = shard_budget();
+    while (s.bytes > budget && !s.lru.empty()) {
+      auto& e = s.lru.back();
+      s.index.erase(&e.key);
+      s.bytes -= e.cost;
+      s.lru.pop_back();
+    }
+  }
+
+  // Drops the entries whose keys fail `keep`
+  template <typename F>
+  void retain(F keep) {
+    for (auto& s : shards) {
+      const std::scoped_lock guard(s.lock);
+      for (auto it = s.lru.begin(); it != s.lru.end(); ) {
+        if (keep(it->key)) { it++; continue; }
+        s.index.erase(&it->key);
+        s.bytes -= it->cost;
+        it = s.lru.erase(it);
+      }
+    }
+  }
+
+  void clear() { retain([](const K&) { return false; }); }
+};
+
+#endif
@@ -2,6 +2,8 @@
 #define GS_SMT_CHECKER_HEADER
 
 #include "ktest.hpp"
+#include "shared_cache.hpp"
+#include "settrie.hpp"
 
 enum solver_result { unsat, sat, unknown };
 using BrResult = std::pair<solver_result, solver_result>;
@@ -15,38 +17,100 @@ inline std::string check_result_to_string(solver_result res) {
   }
 }
 
+// A completed path to generate a test case for: its path condition, moved
+// out of the final state, and what the test case is made of. A job waiting
+// in the test queue holds values, so it is a root of value reclamation.
+struct TestJob : public GCRoot<TestJob> {
+  PC pc;
+  List<SymObj> sym_objs;
+  List<PtrVal> preferred_cex;
+
+  TestJob(SS& state) : pc(std::move(state.get_PC())),
+    sym_objs(state.get_sym_objs()), preferred_cex(state.get_preferred_cex()) {}
+
+  void trace(GCMarker& m) const {
+    pc.trace(m);
+    m.mark_all(preferred_cex);
+  }
+};
+
 class Checker {
 public:
   virtual ~Checker() {}
-  virtual BrResult check_branch(PC& pc, PtrVal cond) = 0;
-  virtual solver_result check_cond(PC& pc) = 0;
-  virtual std::pair<bool, UIntData> get_sat_value(PC pc, PtrVal v) = 0;
-  virtual void generate_test(SS state) = 0;
+  virtual BrResult check_branch(const PC& pc, PtrVal cond) = 0;
+  virtual solver_result check_cond(const PC& pc) = 0;
+  virtual std::pair<bool, UIntData> get_sat_value(const PC& pc, PtrVal v) = 0;
+  virtual std::vector<UIntData> get_sat_values(const PC& pc, PtrVal v, size_t limit) = 0;
+  virtual void generate_test(const TestJob& job) = 0;
+  // Drop cache entries that refer to values reclaimed by the current pass
+  virtual void release_dead_values() = 0;
 };
 
+using SolverCacheKey = ConstraintSet;
+using hash_SolverCacheKey = hash_ConstraintSet;
+
+// Values of the variables of a model, independently of the solver
+using Assignment = std::unordered_map<PtrVal, IntData>;
+
+#include "model_eval.hpp"
+#include "persistent_cache.hpp"
+#include "query_log.hpp"
+#include "test_archive.hpp"
+
+// Query results and models shared by the checkers of all threads
+inline SharedCache<SolverCacheKey, solver_result, hash_SolverCacheKey> shared_sat_cache(25);
+inline SharedCache<SolverCacheKey, std::shared_ptr<const Assignment>, hash_SolverCacheKey> shared_model_cache(75);
+
+// Maximum number of models of cached subsets tried on a query
+inline constexpr size_t cex_trie_max_tries = 8;
+// Number of recent models tried by evaluation before solving a branch
+inline constexpr size_t recent_models_size = 16;
+// Number of compiled programs of constraint sets kept by a checker
+inline constexpr size_t model_programs_size = 1024;
+
+inline bool use_shared_cache() { return use_thread_pool && shared_cache_mb > 0; }
+
+// Estimated sizes of shared cache entries
+inline size_t cache_key_cost(const SolverCacheKey& k) { return 64 + 48 * k.size(); }
+inline size_t cache_model_cost(const SolverCacheKey& k, const Assignment& a) {
+  return cache_key_cost(k) + 64 + 32 * a.size();
+}
+
 template <typename Self, typename Expr, typename Model>
 class CachedChecker : public Checker {
 protected:
   using ObjCache = std::unordered_map<PtrVal, Expr>;
-  using BrCacheKey = std::set<PtrVal>;
+  using BrCacheKey = SolverCacheKey;
   using CexCacheKey = BrCacheKey;
+  using hash_BrCacheKey = hash_SolverCacheKey;
 
-  struct hash_BrCacheKey {
-    // Idea: can we use this https://matt.might.net/papers/liang2014godel.pdf?
-    size_t operator()(BrCacheKey const& k) const noexcept {
-      size_t n = 0;
-      for (auto& c : k) n += c->to_SymV()->id;
-      return n;
-    }
-  };
-
-  // TODO: BrCache and MCexCache can be shared among threads
   using BrCache = immer::map_transient<BrCacheKey, solver_result, hash_BrCacheKey>;
   using MCexCache = immer::map_transient<CexCacheKey, std::shared_ptr<Model>, hash_BrCacheKey>;
+  // Models of satisfiable sets, and nullptr for unsatisfiable ones
+  using CexTrie = SetTrie<std::shared_ptr<Model>>;
 
   ObjCache obj_cache;
   BrCache br_cache;
   MCexCache mcex_cache;
+  CexTrie cex_trie;
+  SolverCacheStat* cache_stat;
+  // Incremental mode: the path conditions asserted in the solver context, in
+  // path order, and the lengths of `session` at which its scopes begin
+  std::vector<PtrVal> session;
+  std::vector<size_t> session_scopes;
+  // The last models obtained by this checker, as a ring
+  std::shared_ptr<const Assignment> recent_models[recent_models_size];
+  size_t recent_next = 0;
+  // The programs evaluating constraint sets under models, compiled once per
+  // set; dropped all at once when there are too many
+  std::unordered_map<CexCacheKey, ModelProgram, hash_BrCacheKey> model_programs;
+  // What the current query is for, as logged by --dump-queries
+  QueryKind query_kind = QueryKind::branch;
+
+  CachedChecker() {
+    const std::scoped_lock guard(solver_cache_stats_lock);
+    cache_stat = &solver_cache_stats.emplace_back();
+  }
 
   // Construct the solver expression with object cache for a Value
   inline const Expr construct_expr(PtrVal e) {
@@ -75,10 +139,13 @@ private:
   // Self has to define:
   // - push_internal()
   // - pop_internal()
-  // - check_model_internal()
+  // - check_model_internal(), check_assuming_internal()
   // - construct_expr_internal()
   // - add_constraint_internal()
-  // - eval(), eval_model()
+  // - eval(), eval_model(), eval_cond()
+  // - export_model(), import_model(): from/to the Assignment of shared models
+  // - unsat_core_internal(): a subset of unsat constraints that is unsat, if
+  //   the solver can compute it
 
   void push() {
     auto start = steady_clock::now();
@@ -101,6 +168,38 @@ private:
     ext_solver_time += duration_cast<microseconds>(end - start).count();
   }
 
+  // Aligns the solver context with the path condition of `pc`: pops the
+  // scopes beyond their common prefix, and asserts the rest in a new scope
+  void sync_session(const PC& pc) {
+    auto& conds = pc.conds;
+    size_t k = 0;
+    auto it = conds.begin();
+    while (k < session.size() && it != conds.end() && *it == session[k]) { k++; it++; }
+    while (session.size() > k) {
+      pop();
+      session.resize(session_scopes.back());
+      session_scopes.pop_back();
+    }
+    if (session.size() == conds.size()) return;
+    push();
+    session_scopes.push_back(session.size());
+    for (it = std::next(conds.begin(), session.size()); it != conds.end(); it++) {
+      add_constraint(*it);
+      session.push_back(*it);
+    }
+    session_reused_conds += k;
+  }
+
+  // Pops all scopes of the session, before a query of unrelated conditions
+  void leave_session() {
+    if (session_scopes.empty()) return;
+    while (!session_scopes.empty()) {
+      pop();
+      session_scopes.pop_back();
+    }
+    session.clear();
+  }
+
   void add_constraint(const PtrVal& e) {
     auto start = steady_clock::now();
     self()->add_constraint_internal(to_expr(e));
@@ -109,35 +208,274 @@ private:
     ext_solver_time += duration_cast<microseconds>(end - start).count();
   }
 
-  const solver_result* query_sat_cache(BrCacheKey& conds) {
-    if (use_brcache) return br_cache.find(conds);
+  // Note: `cond` is the branch condition added to the path condition in
+  // `conds`, if any; the model of the path condition alone is tried first.
+  const solver_result* query_sat_cache(BrCacheKey& conds, const PtrVal& cond = nullptr) {
+    if (!use_brcache) return nullptr;
+    cache_stat->lookups.fetch_add(1, std::memory_order_relaxed);
+    if (auto hit = br_cache.find(conds)) {
+      cache_stat->local_hits.fetch_add(1, std::memory_order_relaxed);
+      return hit;
+    }
+    solver_result res;
+    if (use_shared_cache() && shared_sat_cache.find(conds, res)) {
+      cache_stat->shared_hits.fetch_add(1, std::memory_order_relaxed);
+      br_cache.set(conds, res);
+      return br_cache.find(conds);
+    }
+    std::shared_ptr<Model> m;
+    if (use_cexcache && has_unsat_subset(conds)) {
+      res = unsat;
+    } else if (use_cexcache && (m = query_cex_trie(conds))) {
+      res = sat;
+      mcex_cache.set(conds, m);
+    } else if (use_model_reuse && (m = reuse_model(conds, cond))) {
+      res = sat;
+      if (use_cexcache) {
+        mcex_cache.set(conds, m);
+        cex_trie.insert(conds, m);
+      }
+    } else if (!query_persistent_cache(conds, res, m)) {
+      return nullptr;
+    }
+    br_cache.set(conds, res);
+    return br_cache.find(conds);
+  }
+
+  const ModelProgram& program_of(const CexCacheKey& conds) {
+    auto it = model_programs.find(conds);
+    if (it != model_programs.end()) return it->second;
+    if (model_programs.size() >= model_programs_size) model_programs.clear();
+    return model_programs.try_emplace(conds, conds).first->second;
+  }
+
+  void remember_model(std::shared_ptr<const Assignment> a) {
+    recent_models[recent_next++ % recent_models_size] = std::move(a);
+  }
+
+  // A model of `conds` among the model of the path condition without `cond`
+  // and the recent models, found by evaluating `conds` under all of them at once
+  std::shared_ptr<Model> reuse_model(const BrCacheKey& conds, const PtrVal& cond) {
+    std::shared_ptr<const Assignment> parent_model;
+    const Assignment* models[recent_models_size + 1];
+    size_t n = 0;
+    if (cond && use_cexcache) {
+      BrCacheKey parent = conds;
+      parent.erase(cond);
+      if (auto pm = mcex_cache.find(parent)) {
+        parent_model = self()->export_model(*pm, parent);
+        models[n++] = parent_model.get();
+      }
+    }
+    for (size_t i = 1; i <= recent_models_size; i++) {
+      if (auto& a = recent_models[(recent_next - i) % recent_models_size]) models[n++] = a.get();
+    }
+    if (n == 0) return nullptr;
+    auto j = model_eval::first_model(program_of(conds), models, n);
+    if (j < 0) return nullptr;
+    model_reuse_num++;
+    // completed with the (zero) values of unassigned variables
+    auto& a = *models[j];
+    auto full = std::make_shared<Assignment>();
+    for (auto& c : conds) {
+      for (auto v : c->to_SymV()->vars) {
+        auto it = a.find(v);
+        full->emplace(v, it == a.end() ? 0 : it->second);
+      }
+    }
+    return self()->import_model(full);
+  }
+
+  // Whether all of `conds` hold in `m`
+  bool satisfies(const std::shared_ptr<Model>& m, const CexCacheKey& conds) {
+    for (auto& c : conds) {
+      if (!self()->eval_cond(m, c)) return false;
+    }
+    return true;
+  }
+
+  bool has_unsat_subset(const CexCacheKey& conds) {
+    if (cex_trie.find_subset(conds, [](auto& m) { return m == nullptr; })) {
+      cex_unsat_subset_hits++;
+      return true;
+    }
+    return false;
+  }
+
+  // A model of `conds` from a cached superset, or a cached subset whose model
+  // happens to satisfy `conds` as well
+  std::shared_ptr<Model> query_cex_trie(const CexCacheKey& conds) {
+    std::shared_ptr<Model> found;
+    if (cex_trie.find_superset(conds, [&](auto& m) { return (found = m) != nullptr; })) {
+      cex_superset_hits++;
+      return found;
+    }
+    if constexpr (std::is_same_v<std::remove_const_t<Model>, Assignment>) {
+      // the models of the subsets are checked at once, by the program of `conds`
+      auto& p = program_of(conds);
+      if (p.valid()) {
+        std::shared_ptr<Model> candidates[cex_trie_max_tries];
+        const Assignment* models[cex_trie_max_tries];
+        size_t n = 0;
+        cex_trie.find_subset(conds, [&](auto& m) {
+          if (m == nullptr) return false;
+          candidates[n] = m;
+          models[n] = m.get();
+          return ++n == cex_trie_max_tries;
+        });
+        auto j = model_eval::first_model(p, models, n);
+        if (j < 0) return nullptr;
+        cex_subset_model_hits++;
+        return candidates[j];
+      }
+    }
+    size_t tried = 0;
+    auto try_model = [&](auto& m) {
+      if (m == nullptr) return false;
+      if (tried++ == cex_trie_max_tries) return true; // gives up
+      if (!satisfies(m, conds)) return false;
+      found = m;
+      return true;
+    };
+    if (cex_trie.find_subset(conds, try_model) && found) {
+      cex_subset_model_hits++;
+      return found;
+    }
     return nullptr;
   }
 
   void update_sat_cache(solver_result& res, BrCacheKey& conds) {
-    if (use_brcache) br_cache.set(conds, res);
+    if (!use_brcache) return;
+    br_cache.set(conds, res);
+    if (use_shared_cache() && res != unknown) shared_sat_cache.insert(conds, res, cache_key_cost(conds));
   }
 
-  solver_result check_model(BrCacheKey& conds) {
+  // The cached model of `conds`, from this thread or another one
+  std::shared_ptr<Model> query_model_cache(CexCacheKey& conds) {
+    cache_stat->lookups.fetch_add(1, std::memory_order_relaxed);
+    if (auto it = mcex_cache.find(conds)) {
+      cache_stat->local_hits.fetch_add(1, std::memory_order_relaxed);
+      return *it;
+    }
+    std::shared_ptr<const Assignment> a;
+    if (use_shared_cache() && shared_model_cache.find(conds, a)) {
+      cache_stat->shared_hits.fetch_add(1, std::memory_order_relaxed);
+      auto m = self()->import_model(a);
+      mcex_cache.set(conds, m);
+      return m;
+    }
+    if (auto m = query_cex_trie(conds)) {
+      mcex_cache.set(conds, m);
+      return m;
+    }
+    solver_result res;
+    std::shared_ptr<Model> m;
+    if (query_persistent_cache(conds, res, m) && m) return m;
+    return nullptr;
+  }
+
+  // The result of `conds` recorded by an earlier run (or another process),
+  // and its model if it is satisfiable; the entry is copied to the caches
+  // of this checker
+  bool query_persistent_cache(const BrCacheKey& conds, solver_result& res, std::shared_ptr<Model>& m) {
+    QueryKey k;
+    PersistentCache::Entry e;
+    if (!use_persistent_cache() || !persistent_key(conds, k) || !persistent_cache.find(k, e)) return false;
+    res = e.result;
+    if (res == sat) {
+      if (e.model.empty()) return false;
+      auto a = std::make_shared<Assignment>();
+      for (auto& v : e.model) a->emplace(make_SymV(v.name, v.bw), IntData(v.value));
+      m = self()->import_model(a);
+      if (use_model_reuse) remember_model(a);
+      if (use_cexcache) {
+        mcex_cache.set(conds, m);
+        cex_trie.insert(conds, m);
+      }
+    } else if (res == unsat) {
+      if (use_cexcache) cex_trie.insert(conds, nullptr);
+    } else {
+      return false;
+    }
+    persistent_cache_hits++;
+    return true;
+  }
+
+  void update_persistent_cache(const BrCacheKey& conds, solver_result res, const Assignment* a = nullptr) {
+    QueryKey k;
+    if (!persistent_key(conds, k)) return;
+    std::vector<PersistentCache::Var> model;
+    if (a) {
+      model.reserve(a->size());
+      for (auto& [v, i] : *a) model.push_back({ v->to_SymV()->name, uint32_t(v->get_bw()), uint64_t(i) });
+    }
+    persistent_cache.insert(k, res, model);
+  }
+
+  // Checks the asserted constraints, and `assumption` if any
+  solver_result check_model(BrCacheKey& conds, const PtrVal& assumption = nullptr) {
     num_check_model++;
     num_check_model_pc_size += conds.size();
     auto start = steady_clock::now();
-    solver_result result = self()->check_model_internal();
+    solver_result result = assumption ? self()->check_assuming_internal(to_expr(assumption))
+                                      : self()->check_model_internal();
+    auto end = steady_clock::now();
+    auto us = duration_cast<microseconds>(end - start).count();
+    ext_solver_time += us;
+    if (use_query_log()) {
+      // with an assumption, the solver checks the whole session, which is
+      // what is logged rather than the independent subset `conds`
+      if (assumption) {
+        thread_local std::vector<PtrVal> asserted;
+        asserted.assign(session.begin(), session.end());
+        asserted.push_back(assumption);
+        query_log.record(query_kind, asserted, result, us, QueryLogFormat::Session);
+      } else {
+        query_log.record(query_kind, conds, result, us);
+      }
+    }
     update_sat_cache(result, conds);
+    if (result == unsat && use_cexcache) cex_trie.insert(unsat_core(conds), nullptr);
+    if (result == unsat && use_persistent_cache()) update_persistent_cache(conds, result);
+    return result;
+  }
+
+  // A core of the unsat `conds`, so that later queries with the same conflict
+  // are answered by has_unsat_subset, or `conds` itself if there is none
+  BrCacheKey unsat_core(const BrCacheKey& conds) {
+    if (!use_unsat_core || conds.size() < 2) return conds;
+    thread_local std::vector<PtrVal> cs, core;
+    cs.assign(conds.begin(), conds.end());
+    core.clear();
+    auto start = steady_clock::now();
+    bool found = self()->unsat_core_internal(cs, core);
     auto end = steady_clock::now();
     ext_solver_time += duration_cast<microseconds>(end - start).count();
-    return result;
+    if (!found || core.empty() || core.size() >= conds.size()) return conds;
+    unsat_core_num++;
+    unsat_core_dropped += conds.size() - core.size();
+    BrCacheKey k;
+    for (auto& c : core) k.insert(c);
+    return k;
   }
 
-  inline void resolve_indep_uf(UnionFind& uf, PtrVal root, BrCacheKey& result, bool add_root = true) {
+  // Adds the constraints of the class of `root` in `uf` to `result`
+  inline void resolve_indep_uf(const UnionFind& uf, const PtrVal& root, BrCacheKey& result) {
     auto start = steady_clock::now();
-    if (add_root) result.insert(root);
-    auto last_expr = root;
-    while (root != uf.next[last_expr]) {
-      last_expr = uf.next[last_expr];
-      if (!last_expr) break;
-      if (!last_expr->to_SymV()->is_var()) result.insert(last_expr);
-    }
+    auto& terms = uf.terms_of(root);
+    result.insert(terms.begin(), terms.end());
+    auto end = steady_clock::now();
+    cons_indep_time += duration_cast<microseconds>(end - start).count();
+  }
+
+  // Adds the constraints of `uf` that a term over `vars` depends on to `result`,
+  // without joining the term
+  inline void resolve_indep_vars(const UnionFind& uf, const VarSet& vars, BrCacheKey& result) {
+    auto start = steady_clock::now();
+    thread_local std::vector<PtrVal> found;
+    found.clear();
+    uf.for_each_term(vars, [&](const PtrVal& t) { found.push_back(t); });
+    result.insert(found.begin(), found.end());
     auto end = steady_clock::now();
     cons_indep_time += duration_cast<microseconds>(end - start).count();
   }
@@ -145,30 +483,59 @@ private:
   inline std::shared_ptr<Model> update_model_cache(solver_result& res, CexCacheKey& conds) {
     if (res == solver_result::sat) {
       auto m = self()->get_model_internal(conds);
-      if (use_cexcache) mcex_cache.set(conds, m);
+      std::shared_ptr<const Assignment> a;
+      if (use_model_reuse) remember_model(a = self()->export_model(m, conds));
+      if (use_cexcache) {
+        mcex_cache.set(conds, m);
+        cex_trie.insert(conds, m);
+        if (use_shared_cache()) {
+          if (!a) a = self()->export_model(m, conds);
+          shared_model_cache.insert(conds, a, cache_model_cost(conds, *a));
+        }
+      }
+      if (use_persistent_cache()) {
+        if (!a) a = self()->export_model(m, conds);
+        update_persistent_cache(conds, res, a.get());
+      }
       return m;
     }
     return nullptr;
   }
 
-  inline void gen_default_format(PC& pc, std::shared_ptr<Model> model, unsigned int test_id) {
+  // Checks `conds`, the part of `pc` that branch condition `c` depends on
+  // (with `c`), as the session of `pc` assuming `c`. The session holds all
+  // of `pc`, which is satisfiable, so the result and the model hold for
+  // `conds` as well.
+  solver_result check_in_session(const PC& pc, const PtrVal& c, BrCacheKey& conds) {
+    sync_session(pc);
+    auto res = check_model(conds, c);
+    update_model_cache(res, conds);
+    return res;
+  }
+
+  inline void gen_default_format(const PC& pc, std::shared_ptr<Model> model, unsigned int test_id) {
     std::stringstream output;
     output << "Query number: " << (test_id+1) << std::endl;
     output << "Query is sat." << std::endl;
+    for (auto v : pc.vars) {
+      output << v->to_SymV()->name << "=" << self()->eval_model(model, v) << std::endl;
+    }
+    auto content = output.str();
+    if (use_test_archive()) {
+      test_archive.append(test_id, TestFormat::text, content.data(), content.size());
+      return;
+    }
     std::stringstream filename;
     filename << test_dir_str << "/" << test_id << ".test";
     int out_fd = open(filename.str().c_str(), O_RDWR | O_CREAT, 0777);
     if (out_fd == -1) {
       ABORT("Cannot create the test case file, abort.\n");
     }
-    for (auto& v : pc.vars) {
-      output << v->to_SymV()->name << "=" << self()->eval_model(model, v) << std::endl;
-    }
-    int n = write(out_fd, output.str().c_str(), output.str().size());
+    int n = write(out_fd, content.data(), content.size());
     close(out_fd);
   }
 
-  inline void gen_ktest_format(PC& pc, std::shared_ptr<Model> model, unsigned int test_id, List<SymObj> sym_objs) {
+  inline void gen_ktest_format(const PC& pc, std::shared_ptr<Model> model, unsigned int test_id, const List<SymObj>& sym_objs) {
     KTest b;
     b.numArgs = g_conc_argc;
     b.args = g_conc_argv;
@@ -200,12 +567,24 @@ private:
       }
     }
 
-    std::stringstream filename;
-    filename << test_dir_str << "/" << test_id << ".ktest";
-    int success = kTest_toFile(&b, filename.str().c_str());
+    if (use_test_archive()) {
+      char* content = nullptr;
+      size_t size = 0;
+      FILE* f = open_memstream(&content, &size);
+      int success = f && kTest_toStream(&b, f);
+      if (f) fclose(f);
+      if (!success)
+        ABORT("Failed to write ktest to the test archive");
+      test_archive.append(test_id, TestFormat::ktest, content, size);
+      free(content);
+    } else {
+      std::stringstream filename;
+      filename << test_dir_str << "/" << test_id << ".ktest";
+      int success = kTest_toFile(&b, filename.str().c_str());
 
-    if (!success)
-      ABORT("Failed to write ktest to file");
+      if (!success)
+        ABORT("Failed to write ktest to file");
+    }
 
     for (unsigned i = 0; i < b.numObjects; i++) {
       delete[] b.objects[i].name;
@@ -219,16 +598,50 @@ public:
     obj_cache.clear();
     br_cache = BrCache();
     mcex_cache = MCexCache();
+    cex_trie.clear();
+    for (auto& a : recent_models) a.reset();
+  }
+
+  // Note: solver caches are weak, they do not keep values alive. An entry
+  // is dropped if any value in its key is not reachable from a live state,
+  // otherwise a later value allocated at the same address would hit it.
+  virtual void release_dead_values() override {
+    auto is_live_key = [](const auto& k) {
+      for (auto& v : k) if (!gc_is_live(v)) return false;
+      return true;
+    };
+    for (auto it = obj_cache.begin(); it != obj_cache.end(); ) {
+      if (gc_is_live(it->first)) it++;
+      else it = obj_cache.erase(it);
+    }
+    BrCache live_br;
+    for (auto& [k, res] : br_cache.persistent()) {
+      if (is_live_key(k)) live_br.set(k, res);
+    }
+    br_cache = std::move(live_br);
+    MCexCache live_mcex;
+    for (auto& [k, m] : mcex_cache.persistent()) {
+      if (is_live_key(k)) live_mcex.set(k, m);
+    }
+    mcex_cache = std::move(live_mcex);
+    cex_trie.retain(is_live_key);
+    model_programs.clear();
+    for (auto& a : recent_models) {
+      if (a && !std::all_of(a->begin(), a->end(), [](auto& kv) { return gc_is_live(kv.first); })) a.reset();
+    }
+    leave_session();
   }
 
   std::shared_ptr<Model> query_model(CexCacheKey& conds) {
     std::shared_ptr<Model> m;
     if (use_cexcache) {
-      auto it = mcex_cache.find(conds);
-      if (it != nullptr) {
+      if (auto hit = query_model_cache(conds)) {
+        cached_query_num += 1;
+        m = hit;
+      } else if (has_unsat_subset(conds)) {
         cached_query_num += 1;
-        m = *it;
       } else {
+        leave_session();
         push();
         for (auto& v: conds) add_constraint(v);
         auto result = check_model(conds);
@@ -236,6 +649,7 @@ public:
         pop();
       }
     } else {
+      leave_session();
       push();
       for (auto& v: conds) add_constraint(v);
       auto result = check_model(conds);
@@ -245,48 +659,65 @@ public:
     return m;
   }
 
-  virtual solver_result check_cond(PC& pc) override {
-    if (!use_solver) return sat;
-    br_query_num++;
-
-    BrCacheKey indep_pc;
-    if (use_cons_indep) resolve_indep_uf(pc.uf, *std::prev(pc.conds.end()), indep_pc);
-    else indep_pc.insert(pc.conds.begin(), pc.conds.end());
-
-    auto hit = query_sat_cache(indep_pc);
+  // Checks a constraint set through the caches (e.g. a query replayed from
+  // a log, see query_log.hpp)
+  solver_result check_conds(BrCacheKey& conds) {
+    auto hit = query_sat_cache(conds);
     if (hit) return *hit;
 
+    leave_session();
     push();
-    for (auto& v: indep_pc) add_constraint(v);
-    auto res = check_model(indep_pc);
-    update_model_cache(res, indep_pc);
+    for (auto& v: conds) add_constraint(v);
+    auto res = check_model(conds);
+    update_model_cache(res, conds);
     pop();
 
     return res;
   }
 
-  virtual BrResult check_branch(PC& pc, PtrVal cond) override {
+  virtual solver_result check_cond(const PC& pc) override {
+    if (!use_solver) return sat;
+    br_query_num++;
+    query_kind = QueryKind::branch;
+
+    BrCacheKey indep_pc;
+    if (use_cons_indep) resolve_indep_uf(pc.uf, *std::prev(pc.conds.end()), indep_pc);
+    else indep_pc = pc.cond_set;
+
+    return check_conds(indep_pc);
+  }
+
+  virtual BrResult check_branch(const PC& pc, PtrVal cond) override {
     if (!use_solver) return std::make_pair(sat, sat);
     br_query_num += 2;
+    query_kind = QueryKind::branch;
+
+    // Note: the path condition itself is satisfiable
+    if (use_absint) {
+      auto truth = absint::decide(cond, pc.var_doms);
+      if (truth >= 0) {
+        absint_decided_branches++;
+        absint_avoided_queries += 2;
+        return truth ? std::make_pair(sat, unsat) : std::make_pair(unsat, sat);
+      }
+    }
 
     auto start = steady_clock::now();
     auto neg_cond = SymV::neg(cond);
     BrCacheKey common;
     if (use_cons_indep) {
-      UnionFind uf(pc.uf);
-      for (auto& v : cond->to_SymV()->vars) uf.join(v, cond);
-      resolve_indep_uf(uf, cond, common, pc.contains(cond));
+      resolve_indep_vars(pc.uf, cond->to_SymV()->vars, common);
     } else {
-      common.insert(pc.conds.begin(), pc.conds.end());
+      common = pc.cond_set;
     }
     auto end = steady_clock::now();
 
     BrResult result;
     common.insert(cond);
-    auto then_hit = query_sat_cache(common);
+    auto then_hit = query_sat_cache(common, cond);
     if (!pc.contains(cond)) common.erase(cond);
     common.insert(neg_cond);
-    auto else_hit = query_sat_cache(common);
+    auto else_hit = query_sat_cache(common, neg_cond);
     if (!pc.contains(neg_cond)) common.erase(neg_cond);
 
     if (then_hit != nullptr && else_hit != nullptr) {
@@ -302,6 +733,8 @@ public:
       if (result.first == solver_result::unsat) {
         result.second = solver_result::sat;
         update_sat_cache(result.second, common);
+      } else if (use_incremental) {
+        result.second = check_in_session(pc, neg_cond, common);
       } else {
         push();
         for (auto& v: common) add_constraint(v);
@@ -319,6 +752,8 @@ public:
       if (result.second == solver_result::unsat) {
         result.first = solver_result::sat;
         update_sat_cache(result.first, common);
+      } else if (use_incremental) {
+        result.first = check_in_session(pc, cond, common);
       } else {
         push();
         for (auto& v: common) add_constraint(v);
@@ -328,6 +763,20 @@ public:
       }
       auto then_query_time = steady_clock::now();
       then_miss_time += duration_cast<microseconds>(then_query_time - end).count();
+    } else if (use_incremental) {
+      // neither hits cache, both are checked in the session of `pc`
+      common.insert(cond);
+      result.first = check_in_session(pc, cond, common);
+      if (!pc.contains(cond)) common.erase(cond);
+      common.insert(neg_cond);
+      if (result.first == solver_result::unsat) {
+        result.second = solver_result::sat;
+        update_sat_cache(result.second, common);
+      } else {
+        result.second = check_in_session(pc, neg_cond, common);
+      }
+      auto query_both_time = steady_clock::now();
+      both_miss_time += duration_cast<microseconds>(query_both_time - end).count();
     } else {
       // neither hits cache
       push();
@@ -360,77 +809,170 @@ public:
     return result;
   }
 
-  virtual std::pair<bool, UIntData> get_sat_value(PC pc, PtrVal e) override {
+  virtual std::pair<bool, UIntData> get_sat_value(const PC& pc, PtrVal e) override {
     conc_query_num++;
+    query_kind = QueryKind::concretize;
     auto sym_e = e->to_SymV();
     ASSERT(sym_e != nullptr, "concretizing a non-symbolic value");
-    for (auto& v: sym_e->vars) pc.uf.join(v, sym_e);
 
     CexCacheKey conds;
-    if (use_cons_indep) resolve_indep_uf(pc.uf, e, conds, false);
-    else conds.insert(pc.conds.begin(), pc.conds.end());
-    UIntData data = 0;
-    solver_result result;
+    if (use_cons_indep) resolve_indep_vars(pc.uf, sym_e->vars, conds);
+    else conds = pc.cond_set;
+    solver_result result = unsat;
     auto m = query_model(conds);
     if (m != nullptr) result = sat;
     return std::make_pair(result == sat, result == sat ? self()->eval_model(m, e) : 0);
   }
 
-  virtual void generate_test(SS state) override {
-    completed_path_num++;
-    if (only_output_covernew && !state.has_cover_new()) return;
-    if (!use_solver) return;
+  // The feasible values of `e` under `pc`, at most `limit` of them (0 for
+  // all). Each value found is blocked by a disequality added to the same
+  // solver scope, so the constraints of `pc` are asserted only once; the
+  // caches are still tried first at every step.
+  virtual std::vector<UIntData> get_sat_values(const PC& pc, PtrVal e, size_t limit) override {
+    query_kind = QueryKind::concretize;
+    auto sym_e = e->to_SymV();
+    ASSERT(sym_e != nullptr, "concretizing a non-symbolic value");
+
+    CexCacheKey conds;
+    if (use_cons_indep) resolve_indep_vars(pc.uf, sym_e->vars, conds);
+    else conds = pc.cond_set;
+    std::vector<UIntData> values;
+    uint64_t queries = 0;
+    bool asserted = false;
+    while (limit == 0 || values.size() < limit) {
+      conc_query_num++;
+      std::shared_ptr<Model> m;
+      if (use_cexcache && (m = query_model_cache(conds))) {
+        cached_query_num++;
+      } else if (use_cexcache && has_unsat_subset(conds)) {
+        cached_query_num++;
+        break;
+      } else {
+        if (!asserted) {
+          leave_session();
+          push();
+          for (auto& v: conds) add_constraint(v);
+          asserted = true;
+        }
+        queries++;
+        auto result = check_model(conds);
+        m = update_model_cache(result, conds);
+      }
+      if (!m) break;
+      values.push_back(self()->eval_model(m, e));
+      auto block = SymV::neg(int_op_2(iOP::op_eq, e, make_IntV(values.back(), sym_e->bw)));
+      conds.insert(block);
+      if (asserted) add_constraint(block);
+    }
+    if (asserted) pop();
+    sym_access_num++;
+    sym_access_queries += queries;
+    auto max = sym_access_max_queries.load();
+    while (queries > max && !sym_access_max_queries.compare_exchange_weak(max, queries)) {}
+    return values;
+  }
+
+  // A model of `conds`, merged from the models of its independent partitions
+  // (by `uf`), so that each of them is looked up in the caches and solved on
+  // its own. Variables without constraints are left to the defaults of
+  // eval_model.
+  std::shared_ptr<Model> query_partitioned_model(const UnionFind& uf, CexCacheKey& conds) {
+    auto start = steady_clock::now();
+    std::vector<std::pair<uintptr_t, PtrVal>> by_root;
+    by_root.reserve(conds.size());
+    for (auto& c : conds) by_root.emplace_back(uf.find(c).bits(), c);
+    std::sort(by_root.begin(), by_root.end(), [](auto& a, auto& b) { return a.first < b.first; });
+    auto end = steady_clock::now();
+    cons_indep_time += duration_cast<microseconds>(end - start).count();
+    if (by_root.empty() || by_root.front().first == by_root.back().first) {
+      test_partition_num++;
+      return query_model(conds);
+    }
+    auto merged = std::make_shared<Assignment>();
+    for (size_t i = 0, j; i < by_root.size(); i = j) {
+      CexCacheKey part;
+      for (j = i; j < by_root.size() && by_root[j].first == by_root[i].first; j++) part.insert(by_root[j].second);
+      test_partition_num++;
+      auto m = query_model(part);
+      if (m == nullptr) return nullptr;
+      // Note: a cached or reused model can hold values of variables of other
+      // partitions, which need not satisfy them; only those of `part` are kept.
+      auto a = self()->export_model(m, part);
+      VarSet vars;
+      for (auto& c : part) vars = vars | c->to_SymV()->vars;
+      for (auto v : vars) {
+        if (auto it = a->find(v); it != a->end()) merged->emplace(v, it->second);
+      }
+    }
+    return self()->import_model(merged);
+  }
+
+  virtual void generate_test(const TestJob& job) override {
+    query_kind = QueryKind::test_gen;
 
     std::shared_ptr<Model> m;
-    CexCacheKey conds(state.get_PC().conds.begin(), state.get_PC().conds.end());
-    if (state.get_preferred_cex().size() > 0) {
+    CexCacheKey conds = job.pc.cond_set;
+    UnionFind uf = job.pc.uf;
+    if (job.preferred_cex.size() > 0) {
       // Note(GW): the algorithm resolves preferred cex depending
       // on the traversal order of get_preferred_cex. Since once a preferred cex
       // is hold, it is added and preserved when checking the next preferred cex.
-      // This implementation needs to maintain a copy of the original PC every iteration,
-      // and adds all previously established "preferred cex" every time. It
-      // could be improved if we have implemented a "delete" method for UnionFind.
-      CexCacheKey established;
-
-      for (auto& c: state.get_preferred_cex()) {
-        PC pc(state.get_PC());
-        for (auto& t : established) pc.add(t);
-        pc.add(c);
+      // Each one is joined into a snapshot of the union-find holding the
+      // established ones, which is dropped if it does not hold.
+      for (auto& c: job.preferred_cex) {
         CexCacheKey pc_pcex;
-        if (use_cons_indep) resolve_indep_uf(pc.uf, c, pc_pcex);
-        else pc_pcex.insert(pc.conds.begin(), pc.conds.end());
+        UnionFind with_c = uf;
+        if (use_cons_indep) {
+          with_c.join(c->to_SymV()->vars, c);
+          resolve_indep_uf(with_c, c, pc_pcex);
+        } else {
+          pc_pcex = conds;
+          pc_pcex.insert(c);
+        }
         m = query_model(pc_pcex);
-        if (m != nullptr) established.insert(c);
+        if (m == nullptr) continue;
+        uf = std::move(with_c);
+        conds.insert(c);
       }
-      conds.insert(established.begin(), established.end());
-      m = query_model(conds);
-    } else {
-      m = query_model(conds);
     }
+    m = use_cons_indep ? query_partitioned_model(uf, conds) : query_model(conds);
     ASSERT(m != nullptr, "Cannot generate test cases for unsat conditions!");
-    generated_test_num++;
-    if (output_ktest) gen_ktest_format(state.get_PC(), m, generated_test_num, state.get_sym_objs());
-    else gen_default_format(state.get_PC(), m, generated_test_num);
+    auto test_id = ++generated_test_num;
+    if (output_ktest) gen_ktest_format(job.pc, m, test_id, job.sym_objs);
+    else gen_default_format(job.pc, m, test_id);
   }
 };
 
 #include "smt_stp.hpp"
 #include "smt_z3.hpp"
+#include "smt_portfolio.hpp"
 
 class CheckerManager {
 public:
   std::map<std::thread::id, std::unique_ptr<Checker>> checker_map;
 
   void init_checkers() {
-    auto fun = [this](auto id) {
-      if (solver_kind == SolverKind::z3) {
-        checker_map[id] = std::make_unique<CheckerZ3>();
-      } else if (solver_kind == SolverKind::stp) {
-        checker_map[id] = std::make_unique<CheckerSTP>();
-      } else ABORT("unknown solver");
-    };
-    fun(std::this_thread::get_id());
-    tp.with_thread_ids(fun);
+    if (use_persistent_query_cache) {
+      auto file = persistent_cache_file.empty() ? output_dir_str + "/query-cache.bin" : persistent_cache_file;
+      persistent_cache.open(file);
+      std::cout << "Persistent query cache: " << file << " (" << persistent_cache.size() << " records)\n";
+    }
+    if (dump_queries) query_log.open(output_dir_str + "/queries.bin");
+    if (archive_tests) test_archive.open(output_dir_str + "/tests.bin");
+    add_checker(std::this_thread::get_id());
+    tp.with_thread_ids([this](auto id) { add_checker(id); });
+  }
+
+  // Note: checkers are added before the threads using them start to work,
+  // as `checker_map` is not synchronized.
+  void add_checker(std::thread::id id) {
+    if (solver_kind == SolverKind::z3) {
+      checker_map[id] = std::make_unique<CheckerZ3>();
+    } else if (solver_kind == SolverKind::stp) {
+      checker_map[id] = std::make_unique<CheckerSTP>();
+    } else if (solver_kind == SolverKind::portfolio) {
+      checker_map[id] = std::make_unique<CheckerPortfolio>();
+    } else ABORT("unknown solver");
   }
 
   Checker& get_checker() {
@@ -439,15 +981,45 @@ public:
     static std::unique_ptr<Checker> wtf(solver_kind == SolverKind::stp ?  static_cast<Checker*>(new CheckerSTP) : static_cast<Checker*>(new CheckerZ3));
     return *(checker_map[std::this_thread::get_id()]);
   }
+
+  void release_dead_values() {
+    for (auto& [id, checker] : checker_map) checker->release_dead_values();
+    auto is_live_key = [](const SolverCacheKey& k) {
+      for (auto& v : k) if (!gc_is_live(v)) return false;
+      return true;
+    };
+    shared_sat_cache.retain(is_live_key);
+    shared_model_cache.retain(is_live_key);
+  }
 };
 
 inline CheckerManager checker_manager;
 
+inline void emit_test(const TestJob& job) {
+  auto start = steady_clock::now();
+  checker_manager.get_checker().generate_test(job);
+  auto end = steady_clock::now();
+  gen_test_time += duration_cast<microseconds>(end - start).count();
+  int_solver_time += duration_cast<microseconds>(end - start).count();
+}
+
+#include "test_queue.hpp"
+
+// Writes out the test cases of the paths completed so far, before exiting
+// without the epilogue
+inline void flush_tests() {
+  test_queue.close();
+  test_archive.close();
+}
+
 // To be compatible with generated code:
 
-inline void init_solvers() { checker_manager.init_checkers(); }
+inline void init_solvers() {
+  checker_manager.init_checkers();
+  test_queue.start();
+}
 
-inline BrResult check_branch(PC pc, PtrVal cond) {
+inline BrResult check_branch(const PC& pc, PtrVal cond) {
   auto start = steady_clock::now();
   auto result = checker_manager.get_checker().check_branch(pc, cond);
   auto end = steady_clock::now();
@@ -455,22 +1027,32 @@ inline BrResult check_branch(PC pc, PtrVal cond) {
   return result;
 }
 
-inline bool check_pc(PC pc) {
+inline bool check_pc(const PC& pc) {
   auto result = checker_manager.get_checker().check_cond(pc);
   return result == solver_result::sat;
 }
 
 inline void check_pc_to_file(SS& state) {
+  completed_path_num++;
+  if (only_output_covernew && !state.has_cover_new()) return;
+  if (!use_solver) return;
+  TestJob job(state);
+  if (test_writers > 0) test_queue.push(std::move(job));
+  else emit_test(job);
+}
+
+inline std::pair<bool, UIntData> get_sat_value(const PC& pc, PtrVal v) {
   auto start = steady_clock::now();
-  checker_manager.get_checker().generate_test(std::move(state));
+  auto result = checker_manager.get_checker().get_sat_value(pc, v);
   auto end = steady_clock::now();
-  gen_test_time += duration_cast<microseconds>(end - start).count();
+  conc_solver_time += duration_cast<microseconds>(end - start).count();
   int_solver_time += duration_cast<microseconds>(end - start).count();
+  return result;
 }
 
-inline std::pair<bool, UIntData> get_sat_value(PC pc, PtrVal v) {
+inline std::vector<UIntData> get_sat_values(const PC& pc, PtrVal v, size_t limit) {
   auto start = steady_clock::now();
-  auto result = checker_manager.get_checker().get_sat_value(std::move(pc), v);
+  auto result = checker_manager.get_checker().get_sat_values(pc, v, limit);
   auto end = steady_clock::now();
   conc_solver_time += duration_cast<microseconds>(end - start).count();
   int_solver_time += duration_cast<microseconds>(end - start).count();
@@ -0,0 +1,275 @@
+#ifndef GS_PORTFOLIO_HEADER
+#define GS_PORTFOLIO_HEADER
+
+/* Racing STP and Z3 on the queries missing the caches */
+
+// The portfolio checker has the caches of a CachedChecker, and solves the
+// queries missing them with both backends: Z3 in the calling thread, and STP
+// in a worker thread of its own. The first answer wins. A slower Z3 is
+// interrupted; STP cannot be, so the following queries go to Z3 alone until
+// the worker is idle again. The winners are counted per query shape, and a
+// shape with a clear winner is solved by that backend alone, except for a
+// race every `portfolio_relearn_period` queries.
+
+inline constexpr size_t portfolio_num_shapes = 32;
+// Races of a shape before choosing a backend for it
+inline constexpr uint32_t portfolio_learn_races = 8;
+inline constexpr uint64_t portfolio_relearn_period = 64;
+// Wins per shape of STP and Z3, shared by all threads
+inline std::atomic<uint32_t> portfolio_shape_wins[portfolio_num_shapes][2];
+
+// Runs tasks in a thread of its own, one at a time
+class SolverWorker {
+  std::mutex lock;
+  std::condition_variable cv;
+  std::function<void()> task;
+  bool busy = false, stop = false;
+  std::thread th;
+
+  void loop() {
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+      cv.wait(guard, [this] { return stop || task; });
+      if (stop) return;
+      auto f = std::move(task);
+      task = nullptr;
+      guard.unlock();
+      f();
+      guard.lock();
+      busy = false;
+      cv.notify_all();
+    }
+  }
+
+public:
+  SolverWorker() : th([this] { loop(); }) {}
+  ~SolverWorker() {
+    wait();
+    {
+      const std::scoped_lock guard(lock);
+      stop = true;
+    }
+    cv.notify_all();
+    th.join();
+  }
+
+  bool idle() {
+    const std::scoped_lock guard(lock);
+    return !busy;
+  }
+  void submit(std::function<void()> f) {
+    const std::scoped_lock guard(lock);
+    ASSERT(!busy, "submitting to a busy solver worker");
+    busy = true;
+    task = std::move(f);
+    cv.notify_all();
+  }
+  void wait() {
+    std::unique_lock<std::mutex> guard(lock);
+    cv.wait(guard, [this] { return !busy; });
+  }
+};
+
+struct PortfolioExpr {
+  PtrVal v;  // built by STP in its own thread
+  expr z3;
+};
+
+class CheckerPortfolio : public CachedChecker<CheckerPortfolio, PortfolioExpr, const Assignment> {
+  enum Backend { STP = 0, Z3 = 1, Both = 2 };
+
+  // The result of STP on one query, written by the worker
+  struct Race {
+    std::mutex lock;
+    std::condition_variable cv;
+    bool z3_running = false;
+    bool stp_done = false, stp_first = false;
+    solver_result stp_res = solver_result::unknown;
+    std::shared_ptr<const Assignment> stp_model;
+  };
+
+  CheckerSTP stp;
+  CheckerZ3 z3;
+  SolverWorker stp_worker;
+  // The constraints asserted in the Z3 solver, and the sizes at its scopes
+  std::vector<PtrVal> asserted;
+  std::vector<size_t> scopes;
+  Backend winner = Z3;
+  std::shared_ptr<const Assignment> stp_model;
+  uint64_t num_queries = 0;
+
+  // The size of the query (log2) and whether it has ite, concat or select nodes
+  size_t shape_of(const PtrVal* assumption) {
+    size_t size = 0;
+    bool ite = false;
+    auto visit = [&](const PtrVal& c) {
+      size += c->to_SymV()->term_size;
+      // a bounded search from the root
+      std::vector<simple_ptr<SymV>> todo { c->to_SymV() };
+      for (size_t n = 0; n < 32 && !todo.empty() && !ite; n++) {
+        auto s = todo.back();
+        todo.pop_back();
+        ite = s->rator == iOP::op_ite || s->rator == iOP::op_concat || s->rator == iOP::op_select;
+        for (auto& r : s->rands) if (auto rs = r->to_SymV()) todo.push_back(rs);
+      }
+    };
+    for (auto& c : asserted) visit(c);
+    if (assumption) visit(*assumption);
+    size_t bucket = std::min<size_t>(15, 63 - __builtin_clzll(size + 1));
+    return bucket * 2 + ite;
+  }
+
+  Backend choose(size_t shape) {
+    auto s = portfolio_shape_wins[shape][STP].load(), z = portfolio_shape_wins[shape][Z3].load();
+    auto n = s + z;
+    if (n < portfolio_learn_races || num_queries % portfolio_relearn_period == 0) return Both;
+    if (s * 4 >= n * 3) return STP;
+    if (z * 4 >= n * 3) return Z3;
+    return Both;
+  }
+
+  // Solves `q` from scratch with STP, in the worker thread
+  void stp_solve(std::vector<PtrVal> q, std::shared_ptr<Race> race) {
+    stp.push_internal();
+    for (auto& c : q) stp.add_constraint_internal(stp.construct_expr_internal(c));
+    auto res = stp.check_model_internal();
+    std::shared_ptr<const Assignment> m;
+    if (res == solver_result::sat) {
+      ConstraintSet conds(q.begin(), q.end());
+      m = stp.get_model_internal(conds);
+    }
+    stp.pop_internal();
+    const std::scoped_lock guard(race->lock);
+    race->stp_done = true;
+    race->stp_res = res;
+    race->stp_model = std::move(m);
+    if (race->z3_running) {
+      race->stp_first = true;
+      z3.interrupt();
+    }
+    race->cv.notify_all();
+  }
+
+  solver_result z3_solve(const PortfolioExpr* assumption) {
+    return assumption ? z3.check_assuming_internal(assumption->z3) : z3.check_model_internal();
+  }
+
+  solver_result solve(const PortfolioExpr* assumption) {
+    num_queries++;
+    auto shape = shape_of(assumption ? &assumption->v : nullptr);
+    auto b = choose(shape);
+    if (b != Z3 && !stp_worker.idle()) b = Z3; // still running a lost race
+    if (b == Z3) {
+      portfolio_single_queries++;
+      winner = Z3;
+      return z3_solve(assumption);
+    }
+    auto race = std::make_shared<Race>();
+    auto q = asserted;
+    if (assumption) q.push_back(assumption->v);
+    stp_worker.submit([this, q = std::move(q), race]() mutable { stp_solve(std::move(q), race); });
+    solver_result res;
+    if (b == STP) {
+      portfolio_single_queries++;
+      stp_worker.wait();
+    } else {
+      portfolio_races++;
+      {
+        const std::scoped_lock guard(race->lock);
+        race->z3_running = true;
+      }
+      res = z3_solve(assumption);
+      std::unique_lock<std::mutex> guard(race->lock);
+      race->z3_running = false;
+      // an unknown from Z3 waits for STP
+      if (res == solver_result::unknown) race->cv.wait(guard, [&] { return race->stp_done; });
+      if (!race->stp_first && res != solver_result::unknown) {
+        winner = Z3;
+        portfolio_z3_wins++;
+        portfolio_shape_wins[shape][Z3]++;
+        return res;
+      }
+      portfolio_stp_wins++;
+      portfolio_shape_wins[shape][STP]++;
+    }
+    winner = STP;
+    stp_model = race->stp_model;
+    return race->stp_res;
+  }
+
+public:
+  CheckerPortfolio() {
+    std::cout << "Use the portfolio of STP and Z3\n";
+  }
+  virtual ~CheckerPortfolio() override {
+    stp_worker.wait();
+    clear_cache();
+  }
+
+  PortfolioExpr construct_expr_internal(PtrVal e) {
+    return { e, z3.construct_expr_internal(e) };
+  }
+  void add_constraint_internal(PortfolioExpr e) {
+    z3.add_constraint_internal(e.z3);
+    asserted.push_back(e.v);
+  }
+  solver_result check_model_internal() {
+    return solve(nullptr);
+  }
+  solver_result check_assuming_internal(PortfolioExpr e) {
+    return solve(&e);
+  }
+  void push_internal() {
+    z3.push_internal();
+    scopes.push_back(asserted.size());
+  }
+  void pop_internal() {
+    z3.pop_internal();
+    asserted.resize(scopes.back());
+    scopes.pop_back();
+  }
+  void reset_internal() {
+    z3.reset_internal();
+    asserted.clear();
+    scopes.clear();
+  }
+
+  bool unsat_core_internal(const std::vector<PtrVal>& conds, std::vector<PtrVal>& core) {
+    return z3.unsat_core_internal(conds, core);
+  }
+
+  // Models are Assignments, whichever backend found them
+  inline std::shared_ptr<const Assignment> get_model_internal(BrCacheKey& conds) {
+    if (winner == STP) return stp_model;
+    return z3.export_model(z3.get_model_internal(conds), conds);
+  }
+  inline std::shared_ptr<const Assignment> export_model(std::shared_ptr<const Assignment> m, BrCacheKey& /*conds*/) {
+    return m;
+  }
+  inline std::shared_ptr<const Assignment> import_model(std::shared_ptr<const Assignment> a) {
+    return a;
+  }
+
+  inline IntData eval_model(std::shared_ptr<const Assignment> m, PtrVal val) {
+    uint64_t v;
+    if (model_eval::eval_term(*m, val, v)) {
+      auto bw = val->get_bw();
+      return int64_t(v << (64 - bw)) >> (64 - bw);
+    }
+    return stp.__eval_model(m, val)->to_IntV()->as_signed();
+  }
+  inline bool eval_cond(std::shared_ptr<const Assignment> m, PtrVal cond) {
+    uint64_t v;
+    if (model_eval::eval_term(*m, cond, v)) return v != 0;
+    return stp.__eval_model(m, cond)->to_IntV()->i != 0;
+  }
+
+  virtual void release_dead_values() override {
+    stp_worker.wait();
+    stp.release_dead_values();
+    z3.release_dead_values();
+    CachedChecker::release_dead_values();
+  }
+};
+
+#endif
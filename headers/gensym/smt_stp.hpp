@@ -13,9 +13,10 @@ struct ExprHandle: public std::shared_ptr<void> {
   ExprHandle(Expr e): Base(e, freeExpr) {}
 };
 
-using STPModel = std::unordered_map<PtrVal, IntData>;
+using STPModel = Assignment;
 
-class CheckerSTP : public CachedChecker<CheckerSTP, ExprHandle, STPModel> {
+// Note: models are immutable once materialized, so they are shared as they are
+class CheckerSTP : public CachedChecker<CheckerSTP, ExprHandle, const STPModel> {
 public:
   VC vc;
 
@@ -49,6 +50,7 @@ public:
     case iOP::op_mul:
       return vc_bvMultExpr(vc, bw, expr_rands[0].get(), expr_rands[1].get());
     case iOP::op_sdiv:
+      return vc_sbvDivExpr(vc, bw, expr_rands[0].get(), expr_rands[1].get());
     case iOP::op_udiv:
       return vc_bvDivExpr(vc, bw, expr_rands[0].get(), expr_rands[1].get());
     case iOP::op_uge:
@@ -150,6 +152,22 @@ public:
       return vc_trueExpr(vc);
     case iOP::const_false:
       return vc_falseExpr(vc);
+    case iOP::op_array: {
+      // the bytes stored over a fresh array, whose other elements are never read
+      auto name = "array_" + std::to_string(sym_e->id);
+      ExprHandle arr = vc_varExpr(vc, name.c_str(), vc_arrayType(vc, vc_bvType(vc, addr_index_bw), vc_bvType(vc, 8)));
+      for (size_t i = 0; i < expr_rands.size(); i++) {
+        ExprHandle idx = vc_bvConstExprFromLL(vc, addr_index_bw, i);
+        arr = vc_writeExpr(vc, arr.get(), idx.get(), expr_rands[i].get());
+      }
+      return arr;
+    }
+    case iOP::op_select: {
+      auto size = sym_e->rands[0]->to_SymV()->rands.size();
+      ExprHandle in_bound = vc_bvLtExpr(vc, expr_rands[1].get(), vc_bvConstExprFromLL(vc, addr_index_bw, size));
+      ExprHandle byte = vc_readExpr(vc, expr_rands[0].get(), expr_rands[1].get());
+      return vc_iteExpr(vc, in_bound.get(), byte.get(), vc_bvConstExprFromLL(vc, 8, 0));
+    }
     default: break;
     }
     ABORT("unkown operator when constructing STP expr");
@@ -166,23 +184,45 @@ public:
     return mapping[retcode];
   }
 
+  // Note: asks whether the constraints imply the negation of `e`; if they do
+  // not, the counterexample is a model of the constraints with `e`.
+  solver_result check_assuming_internal(ExprHandle e) {
+    ExprHandle ne = vc_notExpr(vc, e.get());
+    int retcode = vc_query(vc, ne.get());
+    static solver_result mapping[4] = {sat, unsat, unknown, unknown};
+    return mapping[retcode];
+  }
+
+  // Note: the C interface of STP has no unsat cores
+  bool unsat_core_internal(const std::vector<PtrVal>& /*conds*/, std::vector<PtrVal>& /*core*/) {
+    return false;
+  }
+
   inline IntData eval(ExprHandle val) {
     ExprHandle const_val = vc_getCounterExample(vc, val.get());
     return getBVUnsignedLongLong(const_val.get());
   }
 
-  inline std::shared_ptr<STPModel> get_model_internal(BrCacheKey& conds) {
+  inline std::shared_ptr<const STPModel> get_model_internal(BrCacheKey& conds) {
     // Note: STP's WholeCounterExample is pretty useless, so it seems that
     // we have to eagerly materialize the model to our own data structure.
     auto model = std::make_shared<std::unordered_map<PtrVal, IntData>>();
-    for (auto& e: conds) {
-      for (auto& v: e->to_SymV()->vars)
-        model->emplace(v, eval(construct_expr(v)));
-    }
+    VarSet vars;
+    for (auto& e: conds) vars = vars | e->to_SymV()->vars;
+    model->reserve(vars.size());
+    for (auto v: vars) model->emplace(v, eval(construct_expr(v)));
     return model;
   }
 
-  PtrVal __eval_model(std::shared_ptr<STPModel> m, PtrVal val) {
+  inline std::shared_ptr<const Assignment> export_model(std::shared_ptr<const STPModel> m, BrCacheKey& /*conds*/) {
+    return m;
+  }
+
+  inline std::shared_ptr<const STPModel> import_model(std::shared_ptr<const Assignment> a) {
+    return a;
+  }
+
+  PtrVal __eval_model(std::shared_ptr<const STPModel> m, PtrVal val) {
     // Note: when concretizing a complex expression, we need to "interpret"
     // over the symbolic expression since the model only contains values
     // of atomic variables. Here we reuse the `int_op_n` mechanism (thus
@@ -200,6 +240,11 @@ public:
       auto lo = (*sym_val)[2]->to_IntV()->as_signed();
       return bv_extract(__eval_model(m, (*sym_val)[0]), hi, lo);
     }
+    if (sym_val->rator == iOP::op_select) {
+      auto& bytes = (*sym_val)[0]->to_SymV()->rands;
+      auto idx = uint64_t(__eval_model(m, (*sym_val)[1])->to_IntV()->as_signed()) & BVDomain::mask(addr_index_bw);
+      return idx < bytes.size() ? __eval_model(m, bytes[idx]) : make_IntV(0, 8);
+    }
     if (sym_val->rands.size() == 1) {
       if (sym_val->rator == iOP::op_trunc) {
         auto from = (*sym_val)[0]->get_bw();
@@ -217,10 +262,23 @@ public:
     ABORT("Unknown operation");
   }
 
-  inline IntData eval_model(std::shared_ptr<STPModel> m, PtrVal val) {
+  // Note: terms of at most 64 bits are evaluated by a ModelProgram instead,
+  // without building the intermediate values
+  inline IntData eval_model(std::shared_ptr<const STPModel> m, PtrVal val) {
+    uint64_t v;
+    if (model_eval::eval_term(*m, val, v)) {
+      auto bw = val->get_bw();
+      return int64_t(v << (64 - bw)) >> (64 - bw);
+    }
     return __eval_model(m, val)->to_IntV()->as_signed();
   }
 
+  inline bool eval_cond(std::shared_ptr<const STPModel> m, PtrVal cond) {
+    uint64_t v;
+    if (model_eval::eval_term(*m, cond, v)) return v != 0;
+    return __eval_model(m, cond)->to_IntV()->i != 0;
+  }
+
   CheckerSTP() {
     std::cout << "Use STP solver\n";
     vc = vc_createValidityChecker();
@@ -26,11 +26,55 @@ public:
     auto result = g_solver->check();
     return (solver_result) result;
   }
+  solver_result check_assuming_internal(expr e) {
+    expr_vector assumptions(*ctx);
+    assumptions.push_back(e);
+    return (solver_result) g_solver->check(assumptions);
+  }
+
+  // Note: the core is found by another solver, over literals tracking the
+  // constraints, so that the context of g_solver is kept
+  bool unsat_core_internal(const std::vector<PtrVal>& conds, std::vector<PtrVal>& core) {
+    solver s(*ctx);
+    params p(*ctx);
+    p.set("core.minimize", true);
+    s.set(p);
+    expr_vector lits(*ctx);
+    for (size_t i = 0; i < conds.size(); i++) {
+      auto lit = ctx->bool_const(("core!" + std::to_string(i)).c_str());
+      s.add(implies(lit, construct_expr(conds[i])));
+      lits.push_back(lit);
+    }
+    if (s.check(lits) != z3::unsat) return false;
+    auto uc = s.unsat_core();
+    for (unsigned i = 0; i < uc.size(); i++)
+      core.push_back(conds[std::stoul(uc[i].decl().name().str().substr(5))]);
+    return true;
+  }
 
   inline std::shared_ptr<model> get_model_internal(BrCacheKey& conds) {
     return std::make_shared<model>(g_solver->get_model());
   }
 
+  inline std::shared_ptr<const Assignment> export_model(std::shared_ptr<model> m, BrCacheKey& conds) {
+    auto a = std::make_shared<Assignment>();
+    VarSet vars;
+    for (auto& e: conds) vars = vars | e->to_SymV()->vars;
+    a->reserve(vars.size());
+    for (auto v: vars) a->emplace(v, m->eval(construct_expr(v), true).get_numeral_uint64());
+    return a;
+  }
+
+  inline std::shared_ptr<model> import_model(std::shared_ptr<const Assignment> a) {
+    auto m = std::make_shared<model>(*ctx);
+    for (auto& [v, i] : *a) {
+      auto decl = construct_expr(v).decl();
+      auto val = ctx->bv_val(uint64_t(i), v->get_bw());
+      m->add_const_interp(decl, val);
+    }
+    return m;
+  }
+
   inline IntData eval(expr val) {
     auto const_val = g_solver->get_model().eval(val, true);
     return const_val.get_numeral_uint64();
@@ -40,6 +84,10 @@ public:
     return m->eval(construct_expr(val), true).get_numeral_uint64();
   }
 
+  inline bool eval_cond(std::shared_ptr<model> m, PtrVal cond) {
+    return m->eval(construct_expr(cond), true).is_true();
+  }
+
   expr construct_expr_internal(PtrVal e) {
     auto int_e = std::dynamic_pointer_cast<IntV>(e);
     if (int_e) {
@@ -69,8 +117,9 @@ public:
       case iOP::op_mul:
         return expr_rands[0] * expr_rands[1];
       case iOP::op_sdiv:
-      case iOP::op_udiv:
         return expr_rands[0] / expr_rands[1];
+      case iOP::op_udiv:
+        return udiv(expr_rands[0], expr_rands[1]);
       case iOP::op_uge:
         return uge(expr_rands[0], expr_rands[1]);
       case iOP::op_sge:
@@ -159,6 +208,15 @@ public:
         return ctx->bool_val(true);
       case iOP::const_false:
         return ctx->bool_val(false);
+      case iOP::op_array: {
+        // the bytes stored over an array of zeros
+        auto arr = const_array(ctx->bv_sort(addr_index_bw), ctx->bv_val(0, 8));
+        for (size_t i = 0; i < expr_rands.size(); i++)
+          arr = store(arr, ctx->bv_val(uint64_t(i), addr_index_bw), expr_rands[i]);
+        return arr;
+      }
+      case iOP::op_select:
+        return select(expr_rands[0], expr_rands[1]);
       default: break;
     }
     ABORT("unkown operator when constructing STP expr");
@@ -174,6 +232,10 @@ public:
   void reset_internal() {
     g_solver->reset();
   }
+  // Stops a running check (from another thread), which then gives unknown
+  void interrupt() {
+    ctx->interrupt();
+  }
 };
 
 #endif
@@ -324,6 +324,15 @@ class SS {
       if (loc->k == LocV::kStack) return stack.at(loc->l);
       return heap.at(loc->l);
     }
+    // The object of `symloc` as an array, or nullptr, see make_object_array
+    PtrVal object_array(const simple_ptr<SymLocV>& symloc) {
+      size_t base = symloc->base;
+      if (symloc->k == LocV::kStack)
+        return make_object_array(symloc->size, [&](size_t i) { return stack.at(base + i); },
+                                 [&](size_t i) { return stack.at(base + i, 1); });
+      return make_object_array(symloc->size, [&](size_t i) { return heap.at(base + i); },
+                               [&](size_t i) { return heap.at(base + i, 1); });
+    }
     PtrVal at(PtrVal addr, int size) {
       auto loc = std::dynamic_pointer_cast<LocV>(addr);
       if (loc != nullptr) {
@@ -337,29 +346,26 @@ class SS {
         ASSERT(offsym && (offsym->get_bw() == addr_index_bw), "Invalid sym offset");
         bool reach_limit = (max_sym_array_size > 0) && (symloc->size >= max_sym_array_size);
         bool resolve_once = reach_limit || (SymLocStrategy::one == symloc_strategy);
+        if (SymLocStrategy::array == symloc_strategy && !reach_limit) {
+          if (auto arr = object_array(symloc)) return array_read(arr, symloc->off, size);
+        }
         if (resolve_once || SymLocStrategy::feasible == symloc_strategy) {
-          int cnt_bound = -1;
           int cnt = 0;
-          if (resolve_once)
-            cnt_bound = 1;
+          size_t limit = resolve_once ? 1 : (symloc->size - size + 1);
           auto low_cond = int_op_2(iOP::op_sge, offsym, make_IntV(0, addr_index_bw));
           auto high_cond = int_op_2(iOP::op_sle, offsym, make_IntV(symloc->size - size, addr_index_bw));
           auto pc2 = pc;
           pc2.add(low_cond).add(high_cond);
-          auto res = get_sat_value(pc2, offsym);
-          while (res.first) {
+          for (int offset_val : get_sat_values(pc2, offsym, limit)) {
             cnt++;
-            int offset_val = res.second;
             auto t_cond = int_op_2(iOP::op_eq, offsym, make_IntV(offset_val, offsym->get_bw()));
             result.push_back(std::make_pair(t_cond, offset_val));
-            if (cnt_bound == cnt)
-              break;
-            pc2.add(SymV::neg(t_cond));
-            res = get_sat_value(pc2, offsym);
           }
           ASSERT(cnt > 0, "No satisfiable offset value");
         } else {
-          ASSERT(SymLocStrategy::all == symloc_strategy, "Bad symloc strategy");
+          // Note: objects that are not arrays of bytes are read with the ite chain
+          ASSERT(SymLocStrategy::all == symloc_strategy || SymLocStrategy::array == symloc_strategy,
+                 "Bad symloc strategy");
           for (int offset_val=0; offset_val <= (symloc->size - size); offset_val++) {
             auto t_cond = int_op_2(iOP::op_eq, offsym, make_IntV(offset_val, offsym->get_bw()));
             result.push_back(std::make_pair(t_cond, offset_val));
@@ -46,6 +46,7 @@ class PreMem {
     // PreMem<V> drop(size_t d) { return PreMem<V>(mem.drop(d)); }
     TrList<V> get_mem() { return mem; }
     List<V> get_pmem() { return mem.persistent(); }
+    void trace(GCMarker& m) const { m.mark_all(mem); }
 };
 
 class Mem: public PreMem<PtrVal, Mem> {
@@ -54,10 +55,6 @@ class Mem: public PreMem<PtrVal, Mem> {
     return bv_extract(v0, (e - b0) * 8 - 1, (b - b0) * 8);
   }
 
-  static PtrVal q_concat(PtrVal v1, PtrVal v2) {
-    return int_op_2(iOP::op_concat, v2, v1);
-  }
-
   struct Segment {
     PtrVal val; size_t begin, size, end;
     Segment(PtrVal v, size_t b, size_t s): val(v), begin(b), size(s), end(b + s) { }
@@ -67,14 +64,6 @@ class Mem: public PreMem<PtrVal, Mem> {
       PtrVal v = (begin < b || e < end) ? q_extract(val, begin, b, e, end) : val;
       return {v, b, e - b};
     }
-    Segment left_sub(const Segment &rhs) const {
-      PtrVal v = (rhs.begin > begin) ? q_extract(val, begin, begin, rhs.begin, end) : nullptr;
-      return {v, begin, rhs.begin};
-    }
-    Segment right_sub(const Segment &lhs) const {
-      PtrVal v = (lhs.end < end) ? q_extract(val, begin, lhs.end, end, end) : nullptr;
-      return {v, lhs.end, end};
-    }
   };
 
   Segment lookup(size_t idx, size_t size) const {
@@ -85,7 +74,7 @@ class Mem: public PreMem<PtrVal, Mem> {
       return { cur, idx, sz };
     }
     while (std::dynamic_pointer_cast<ShadowV>(cur)) cur = mem.at(--idx);
-    return { cur, idx, size_t(cur->get_bw() + 7) / 8 };
+    return { cur, idx, size_t(bw_of(cur) + 7) / 8 };
   }
 
   bool is_intact(const Segment &seg) const {
@@ -116,18 +105,22 @@ public:
   using PreMem::update;
 
   PtrVal at(size_t idx, int size) {
-    auto first = lookup(idx, size);
-    auto part = first.intersect({nullptr, idx, size_t(size)});
-    auto cur = part.val;
-    // part.size is unsigned, size will be casted to unsigned
     ASSERT(size > 0, "size should be greater than zero");
-    if (part.size < size) {
-      auto next = at(idx + part.size, size - part.size);
-      possible_partial_undef(cur);
-      possible_partial_undef(next);
-      cur = q_concat(cur, next);
-    }
-    return cur;
+    size_t end = idx + size;
+    auto seg = lookup(idx, size);
+    if (seg.end >= end) return seg.intersect({nullptr, idx, size_t(size)}).val;
+    // Note: the parts are assembled directly, rather than extracted and
+    // concatenated one by one, see WordAssembler.
+    WordAssembler word;
+    while (true) {
+      possible_partial_undef(seg.val);
+      size_t b = std::max(seg.begin, idx), e = std::min(seg.end, end);
+      word.push(seg.val, (e - seg.begin) * 8 - 1, (b - seg.begin) * 8);
+      if (e == end) break;
+      idx = e;
+      seg = lookup(idx, end - idx);
+    }
+    return word.finish();
   }
 
   Mem&& update(size_t idx, PtrVal val, int size) {
@@ -144,12 +137,13 @@ public:
       for (idx = newval.begin; idx < newval.end; ) {
         // load current
         auto curval = lookup(idx, newval.end - idx);
-        auto newcur = newval.intersect(curval);
-        auto v_new = newcur.val;
-        auto v_head = curval.left_sub(newcur).val;
-        if (v_head) v_new = q_concat(v_head, v_new);
-        auto v_tail = curval.right_sub(newcur).val;
-        if (v_tail) v_new = q_concat(v_new, v_tail);
+        size_t b = std::max(curval.begin, newval.begin), e = std::min(curval.end, newval.end);
+        // head of the current value, the new bytes, and tail of the current value
+        WordAssembler word;
+        if (curval.begin < b) word.push(curval.val, (b - curval.begin) * 8 - 1, 0);
+        word.push(newval.val, (e - newval.begin) * 8 - 1, (b - newval.begin) * 8);
+        if (e < curval.end) word.push(curval.val, curval.size * 8 - 1, (e - curval.begin) * 8);
+        auto v_new = word.finish();
         // store & step
         write_back(curval, v_new);
         idx = curval.end;
@@ -182,6 +176,9 @@ class Frame {
       }
       return std::move(*this);
     }
+    void trace(GCMarker& m) const {
+      for (auto& [id, v] : env) m.mark(v);
+    }
 };
 
 class Stack {
@@ -263,6 +260,11 @@ class Stack {
       mem.alloc(size);
       return std::move(*this);
     }
+    void trace(GCMarker& m) const {
+      mem.trace(m);
+      for (auto& f : env) f.trace(m);
+      m.mark(errno_location);
+    }
 };
 
 #include "unionfind.hpp"
@@ -271,15 +273,19 @@ class PC {
   public:
     TrList<PtrVal> conds;
     UnionFind uf;
-    immer::set_transient<PtrVal> vars;
+    VarSet vars;
+    VarDomains var_doms;
+    // The set of `conds`, as a key of the solver caches
+    ConstraintSet cond_set;
 
     PC(TrList<PtrVal> conds) : conds(std::move(conds)) {
       auto start = steady_clock::now();
-      for (auto& c : conds) {
-        for (auto& v : c->to_SymV()->vars) { 
-          vars.insert(v);
-          uf.join(v, c); 
-        }
+      cond_set.insert(this->conds.begin(), this->conds.end());
+      for (auto& c : this->conds) {
+        auto& cvars = c->to_SymV()->vars;
+        vars = vars | cvars;
+        uf.join(cvars, c);
+        if (use_absint) absint::refine(var_doms, c, true);
       }
       auto end = steady_clock::now();
       cons_indep_time += duration_cast<microseconds>(end - start).count();
@@ -287,17 +293,18 @@ class PC {
     PC&& add(PtrVal e) {
       ASSERT(e->to_SymV(), "added condition must be symbolic boolean");
       conds.push_back(e);
+      cond_set.insert(e);
       auto start = steady_clock::now();
-      for (auto& v : e->to_SymV()->vars) { 
-        vars.insert(v);
-        uf.join(v, e); 
-      }
+      auto& evars = e->to_SymV()->vars;
+      vars = vars | evars;
+      uf.join(evars, e);
+      if (use_absint) absint::refine(var_doms, e, true);
       auto end = steady_clock::now();
       cons_indep_time += duration_cast<microseconds>(end - start).count();
       return std::move(*this);
     }
-    bool contains(PtrVal e) {
-      return uf.parent.find(e) != nullptr;
+    bool contains(const PtrVal& e) const {
+      return uf.contains(e);
     }
     const TrList<PtrVal>& get_path_conds() { return conds; }
     PtrVal get_last_cond() {
@@ -305,11 +312,13 @@ class PC {
       return nullptr;
     }
     void print() { print_vec<TrList, PtrVal>(conds); }
+    // Note: variables in `vars` and `uf` are all reachable from `conds`.
+    void trace(GCMarker& m) const { m.mark_all(conds); }
 };
 
 #include "metadata.hpp"
 
-class SS {
+class SS: public GCRoot<SS> {
   private:
     Mem heap;
     Stack stack;
@@ -327,11 +336,27 @@ class SS {
       stack(std::move(stack)), pc(std::move(pc)), meta(std::move(meta)), fs(initial_fs)  {}
     SS fork() { return SS(heap, stack, pc, std::move(meta.fork()), fs); }
     SS copy() { return *this; }
+    void trace(GCMarker& m) const {
+      heap.trace(m);
+      stack.trace(m);
+      pc.trace(m);
+      meta.trace(m);
+      fs.trace(m);
+    }
     PtrVal env_lookup(Id id) { return stack.lookup_id(id); }
     size_t heap_size() { return heap.size(); }
     size_t stack_size() { return stack.mem_size(); }
     size_t fresh_stack_addr() { return stack_size(); }
     size_t frame_depth() { return frame_depth(); }
+    // The object of `symloc` as an array, or nullptr, see make_object_array
+    PtrVal object_array(const simple_ptr<SymLocV>& symloc) {
+      size_t base = symloc->base;
+      if (symloc->k == LocV::kStack)
+        return make_object_array(symloc->size, [&](size_t i) { return stack.at(base + i); },
+                                 [&](size_t i) { return stack.at(base + i, 1); });
+      return make_object_array(symloc->size, [&](size_t i) { return heap.at(base + i); },
+                               [&](size_t i) { return heap.at(base + i, 1); });
+    }
     PtrVal at_symloc(simple_ptr<SymLocV> symloc, size_t size) {
       // TODO GW: should refactor this piece of code, strive for readability and maintainability
       ASSERT(symloc != nullptr && symloc->size >= size, "Lookup an non-address value");
@@ -340,32 +365,55 @@ class SS {
       ASSERT(offsym && (offsym->get_bw() == addr_index_bw), "Invalid sym offset");
       bool reach_limit = (max_sym_array_size > 0) && (symloc->size >= max_sym_array_size);
       bool resolve_once = reach_limit || (SymLocStrategy::one == symloc_strategy);
+      if (SymLocStrategy::array == symloc_strategy && !reach_limit) {
+        if (auto arr = object_array(symloc)) return array_read(arr, symloc->off, size);
+      }
+      // the in-bound offsets allowed by the abstract domain of the offset
+      BVDomain offset_dom = use_absint ? absint::eval(symloc->off, pc.var_doms) : BVDomain::top(addr_index_bw);
+      std::vector<uint64_t> cands;
+      bool bounded = use_absint &&
+        absint::offset_candidates(offset_dom, symloc->size - size, absint::offset_limit, cands);
       if (resolve_once || SymLocStrategy::feasible == symloc_strategy) {
-        int cnt_bound = -1;
         int cnt = 0;
-        if (resolve_once)
-          cnt_bound = 1;
         auto low_cond = int_op_2(iOP::op_sge, offsym, make_IntV(0, addr_index_bw));
         auto high_cond = int_op_2(iOP::op_sle, offsym, make_IntV(symloc->size - size, addr_index_bw));
         auto pc2 = pc;
         pc2.add(low_cond).add(high_cond);
-        auto res = get_sat_value(pc2, offsym);
-        while (res.first) {
-          cnt++;
-          int offset_val = res.second;
+        if (bounded && offset_dom.is_const() && !cands.empty()) {
+          // the offset is determined by the path condition
+          int offset_val = cands[0];
           auto t_cond = int_op_2(iOP::op_eq, offsym, make_IntV(offset_val, offsym->get_bw()));
           result.push_back(std::make_pair(t_cond, offset_val));
-          if (cnt_bound == cnt)
-            break;
-          pc2.add(SymV::neg(t_cond));
-          res = get_sat_value(pc2, offsym);
+          cnt = 1;
+          absint_avoided_queries += resolve_once ? 1 : 2;
+        } else {
+          // at most one value per candidate (or in-bound offset)
+          size_t limit = resolve_once ? 1 : bounded ? std::max<size_t>(1, cands.size()) : (symloc->size - size + 1);
+          for (int offset_val : get_sat_values(pc2, offsym, limit)) {
+            cnt++;
+            auto t_cond = int_op_2(iOP::op_eq, offsym, make_IntV(offset_val, offsym->get_bw()));
+            result.push_back(std::make_pair(t_cond, offset_val));
+          }
+          if (bounded && !resolve_once && size_t(cnt) == cands.size()) {
+            // all the candidates are found, the next query is unsat
+            absint_avoided_queries++;
+          }
         }
         ASSERT(cnt > 0, "No satisfiable offset value");
       } else {
-        ASSERT(SymLocStrategy::all == symloc_strategy, "Bad symloc strategy");
-        for (int offset_val=0; offset_val <= (symloc->size - size); offset_val++) {
-          auto t_cond = int_op_2(iOP::op_eq, offsym, make_IntV(offset_val, offsym->get_bw()));
-          result.push_back(std::make_pair(t_cond, offset_val));
+        // Note: objects that are not arrays of bytes are read with the ite chain
+        ASSERT(SymLocStrategy::all == symloc_strategy || SymLocStrategy::array == symloc_strategy,
+               "Bad symloc strategy");
+        if (bounded && !cands.empty()) {
+          for (int offset_val : cands) {
+            auto t_cond = int_op_2(iOP::op_eq, offsym, make_IntV(offset_val, offsym->get_bw()));
+            result.push_back(std::make_pair(t_cond, offset_val));
+          }
+        } else {
+          for (int offset_val=0; offset_val <= (symloc->size - size); offset_val++) {
+            auto t_cond = int_op_2(iOP::op_eq, offsym, make_IntV(offset_val, offsym->get_bw()));
+            result.push_back(std::make_pair(t_cond, offset_val));
+          }
         }
       }
       PtrVal read_res = nullptr;
@@ -0,0 +1,188 @@
+#ifndef GS_TEST_ARCHIVE_HEADER
+#define GS_TEST_ARCHIVE_HEADER
+
+/* Test cases stored in one file */
+
+// With --test-archive, test cases are appended to tests.bin in the output
+// folder instead of being written as one file each in the tests folder.
+// Records are batched in memory and written in large chunks; when the
+// archive is closed, an index of the records is appended, so that a test can
+// be found without reading the whole archive. headers/test/extract_tests
+// turns an archive back into .ktest (or .test) files.
+
+enum class TestFormat : uint8_t { ktest, text };
+
+// File layout (native byte order): the magic "GSTARC01", then per test
+//   u32 size (of the whole record); u32 test id; u8 format; u8 0; u16 0;
+//   the content of the test file (a KTest file, or the text of a .test file);
+// and, once the archive is closed, the index:
+//   per test, u32 test id; u32 0; u64 offset of its record;
+//   u64 number of tests; the magic "GSTIDX01".
+struct TestArchiveFormat {
+  static constexpr char magic[8] = { 'G', 'S', 'T', 'A', 'R', 'C', '0', '1' };
+  static constexpr char index_magic[8] = { 'G', 'S', 'T', 'I', 'D', 'X', '0', '1' };
+  static constexpr size_t record_header_size = 12;
+  static constexpr size_t index_entry_size = 16;
+  // Buffered bytes at which records are written out
+  static constexpr size_t batch_size = 1 << 20;
+};
+
+class TestArchive {
+  std::mutex lock;
+  int fd = -1;
+  std::string path;
+  std::string buf;
+  // Size of the file, as of the written records
+  uint64_t file_size = 0;
+  std::vector<std::pair<uint32_t, uint64_t>> index;
+
+  template <typename T>
+  static void store(std::string& buf, T x) {
+    buf.append(reinterpret_cast<const char*>(&x), sizeof(T));
+  }
+
+  void write_out() {
+    if (buf.empty()) return;
+    if (write(fd, buf.data(), buf.size()) != ssize_t(buf.size()))
+      ABORT("Cannot write the test archive " << path);
+    file_size += buf.size();
+    buf.clear();
+  }
+
+public:
+  ~TestArchive() { close(); }
+
+  bool is_open() const { return fd >= 0; }
+
+  void open(const std::string& path) {
+    const std::scoped_lock guard(lock);
+    this->path = path;
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0666);
+    if (fd < 0) ABORT("Cannot open the test archive " << path);
+    buf.assign(TestArchiveFormat::magic, sizeof(TestArchiveFormat::magic));
+    write_out();
+  }
+
+  void append(uint32_t test_id, TestFormat format, const char* data, size_t size) {
+    const std::scoped_lock guard(lock);
+    if (fd < 0) return;
+    index.emplace_back(test_id, file_size + buf.size());
+    store<uint32_t>(buf, TestArchiveFormat::record_header_size + size);
+    store<uint32_t>(buf, test_id);
+    store<uint8_t>(buf, uint8_t(format));
+    store<uint8_t>(buf, 0);
+    store<uint16_t>(buf, 0);
+    buf.append(data, size);
+    if (buf.size() >= TestArchiveFormat::batch_size) write_out();
+  }
+
+  // Writes the buffered records and the index. Note: an archive that is not
+  // closed (e.g. the process is killed) has no index, and is read record by
+  // record up to the last one written.
+  void close() {
+    const std::scoped_lock guard(lock);
+    if (fd < 0) return;
+    for (auto& [id, off] : index) {
+      store<uint32_t>(buf, id);
+      store<uint32_t>(buf, 0);
+      store<uint64_t>(buf, off);
+    }
+    store<uint64_t>(buf, index.size());
+    buf.append(TestArchiveFormat::index_magic, sizeof(TestArchiveFormat::index_magic));
+    write_out();
+    ::close(fd);
+    fd = -1;
+  }
+};
+
+inline TestArchive test_archive;
+
+inline bool use_test_archive() { return test_archive.is_open(); }
+
+// Reads the tests of an archive
+class TestArchiveReader {
+  std::string data;
+  // Test id and offset of the record of each test
+  std::vector<std::pair<uint32_t, uint64_t>> records;
+  std::unordered_map<uint32_t, size_t> by_id;
+
+  template <typename T>
+  T load(size_t off) const {
+    T x;
+    memcpy(&x, data.data() + off, sizeof(T));
+    return x;
+  }
+
+  bool valid_record(uint64_t off) const {
+    if (off + TestArchiveFormat::record_header_size > data.size()) return false;
+    auto size = load<uint32_t>(off);
+    return size >= TestArchiveFormat::record_header_size && off + size <= data.size();
+  }
+
+  bool read_index() {
+    auto n = sizeof(TestArchiveFormat::index_magic);
+    if (data.size() < sizeof(TestArchiveFormat::magic) + n + 8) return false;
+    if (memcmp(data.data() + data.size() - n, TestArchiveFormat::index_magic, n) != 0) return false;
+    auto num = load<uint64_t>(data.size() - n - 8);
+    if (num > data.size() / TestArchiveFormat::index_entry_size) return false;
+    auto index_size = num * TestArchiveFormat::index_entry_size;
+    if (index_size > data.size() - sizeof(TestArchiveFormat::magic) - n - 8) return false;
+    auto p = data.size() - n - 8 - index_size;
+    for (uint64_t i = 0; i < num; i++, p += TestArchiveFormat::index_entry_size) {
+      auto off = load<uint64_t>(p + 8);
+      if (!valid_record(off)) return false;
+      records.emplace_back(load<uint32_t>(p), off);
+    }
+    return true;
+  }
+
+  // Scans the records of an archive without index, up to a torn record
+  void scan() {
+    uint64_t off = sizeof(TestArchiveFormat::magic);
+    while (valid_record(off)) {
+      records.emplace_back(load<uint32_t>(off + 4), off);
+      off += load<uint32_t>(off);
+    }
+  }
+
+public:
+  struct Test {
+    uint32_t id;
+    TestFormat format;
+    const char* data;
+    size_t size;
+  };
+
+  explicit TestArchiveReader(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) ABORT("Cannot open the test archive " << path);
+    data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    if (data.size() < sizeof(TestArchiveFormat::magic) ||
+        memcmp(data.data(), TestArchiveFormat::magic, sizeof(TestArchiveFormat::magic)) != 0)
+      ABORT(path << " is not a test archive");
+    if (!read_index()) {
+      records.clear();
+      scan();
+    }
+    for (size_t i = 0; i < records.size(); i++) by_id.emplace(records[i].first, i);
+  }
+
+  size_t size() const { return records.size(); }
+
+  Test at(size_t i) const {
+    auto off = records[i].second;
+    return Test { records[i].first, TestFormat(load<uint8_t>(off + 8)),
+                  data.data() + off + TestArchiveFormat::record_header_size,
+                  load<uint32_t>(off) - TestArchiveFormat::record_header_size };
+  }
+
+  // The test of id `id`, false if the archive does not have it
+  bool find(uint32_t id, Test& t) const {
+    auto it = by_id.find(id);
+    if (it == by_id.end()) return false;
+    t = at(it->second);
+    return true;
+  }
+};
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef GS_TEST_QUEUE_HEADER
+#define GS_TEST_QUEUE_HEADER
+
+/* Test cases generated in the background */
+
+// With --test-writers, a thread completing a path pushes its test job into a
+// bounded queue and goes on exploring, and a pool of writer threads, each
+// with its own checker, solves the path conditions and writes the test cases.
+// A full queue blocks the threads completing paths until a writer takes a
+// job, so pending jobs (and the values they hold) are bounded.
+class TestQueue {
+  std::mutex lock;
+  std::condition_variable not_empty, not_full, idle;
+  std::deque<TestJob> jobs;
+  std::vector<std::thread> writers;
+  // Jobs taken by a writer and not done yet
+  size_t busy = 0;
+  bool closed = false;
+  bool paused = false;
+
+  void writer() {
+    std::unique_lock<std::mutex> lk(lock);
+    while (true) {
+      not_empty.wait(lk, [this] { return (!paused && !jobs.empty()) || (closed && jobs.empty()); });
+      if (jobs.empty()) break;
+      busy++;
+      {
+        TestJob job = std::move(jobs.front());
+        jobs.pop_front();
+        test_queue_pending--;
+        lk.unlock();
+        not_full.notify_one();
+        emit_test(job);
+      }
+      lk.lock();
+      if (--busy == 0) idle.notify_all();
+    }
+  }
+
+public:
+  ~TestQueue() { stop(); }
+
+  void start() {
+    for (unsigned i = 0; i < test_writers; i++) {
+      writers.emplace_back(&TestQueue::writer, this);
+      checker_manager.add_checker(writers.back().get_id());
+    }
+  }
+
+  // Jobs pushed after the queue is closed are dropped
+  void push(TestJob job) {
+    std::unique_lock<std::mutex> lk(lock);
+    if (jobs.size() >= test_queue_capacity) {
+      test_queue_waits++;
+      not_full.wait(lk, [this] { return closed || jobs.size() < test_queue_capacity; });
+    }
+    if (closed) return;
+    jobs.push_back(std::move(job));
+    auto n = ++test_queue_pending;
+    if (n > test_queue_max) test_queue_max = n;
+    lk.unlock();
+    not_empty.notify_one();
+  }
+
+  // Stops taking jobs and waits for the writers to finish the pending ones.
+  // Can be called from any thread, for example by the monitor on timeout.
+  void close() {
+    std::unique_lock<std::mutex> lk(lock);
+    closed = true;
+    not_empty.notify_all();
+    not_full.notify_all();
+    idle.wait(lk, [this] { return jobs.empty() && busy == 0; });
+  }
+
+  void stop() {
+    close();
+    for (auto& w : writers) if (w.joinable()) w.join();
+  }
+
+  // Waits for the writers to finish their current job, and keeps them from
+  // taking another one until `resume`; used by value reclamation.
+  void pause() {
+    std::unique_lock<std::mutex> lk(lock);
+    paused = true;
+    idle.wait(lk, [this] { return busy == 0; });
+  }
+
+  void resume() {
+    {
+      const std::scoped_lock guard(lock);
+      paused = false;
+    }
+    not_empty.notify_all();
+  }
+};
+
+inline TestQueue test_queue;
+
+#endif
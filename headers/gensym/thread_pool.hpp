@@ -31,6 +31,8 @@ inline void ptree_add_task(uint64_t ssid, const TaskFun& f);
 
 inline bool ptree_pop_task(TaskFun& task);
 
+inline void value_gc_safepoint(const std::atomic<bool>& running);
+
 struct Task {
   TaskFun f;
   int weight;
@@ -124,6 +126,7 @@ public:
 
   void worker(unsigned id) {
     while (running) {
+      value_gc_safepoint(running);
       //std::cout << "Running tasks " << running_tasks_num()
       //          << "; queued tasks " << tasks_num_queued() << "\n";
       struct Task task;
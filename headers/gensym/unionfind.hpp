@@ -1,58 +1,82 @@
 #ifndef GS_UNIONFIND_HEADER
 #define GS_UNIONFIND_HEADER
 
+// A union-find over the terms of a path condition (its constraints, or a term
+// to concretize) and their variables. It is made of persistent maps, so that
+// a copy is an O(1) snapshot: a query joins a term into a copy, and a term
+// that should not be kept is deleted by going back to the snapshot taken
+// before it was joined. Each class keeps the list of its terms, by root.
+// Note: there is no path compression, which would update the maps on finds;
+// union by size keeps the trees of logarithmic depth instead.
 struct UnionFind {
-  immer::map_transient<PtrVal, PtrVal> parent;
-  immer::map_transient<PtrVal, PtrVal> next;
-  immer::map_transient<PtrVal, std::uint32_t> size;
-
-  bool init(PtrVal v) {
-    if (parent.find(v) == nullptr) {
-      parent.set(v, v);
-      next.set(v, v);
-      return false;
-    }
-    return true;
-  }
+  immer::map<PtrVal, PtrVal> parent;
+  // Number of nodes of each class with more than one, by root
+  immer::map<PtrVal, std::uint32_t> size;
+  // Terms of each class, by root
+  immer::map<PtrVal, List<PtrVal>> terms;
 
-  PtrVal find(PtrVal v) {
-    if (!init(v)) return v;
-    PtrVal root = v;
-    while (root != parent[root])
-      root = parent[root];
-    while (v != root) {
-      auto newv = parent[v];
-      parent.set(v, root);
-      v = newv;
+  bool contains(const PtrVal& v) const { return parent.find(v) != nullptr; }
+
+  // The root of the class of `v`, which is `v` if it is not in the union-find
+  PtrVal find(PtrVal v) const {
+    while (auto p = parent.find(v)) {
+      if (*p == v) break;
+      v = *p;
     }
-    return root;
+    return v;
   }
 
-  void print_set(PtrVal v) {
-    auto root = v;
-    std::cout << *v << ", ";
-    while (root != next[v]) {
-      v = next[v];
-      std::cout << *v << ", ";
-    }
-    std::cout << "\n";
+  std::uint32_t size_of(const PtrVal& root) const {
+    auto s = size.find(root);
+    return s ? *s : 1;
   }
 
-  void join(PtrVal p, PtrVal q) {
+  void join(const PtrVal& p, const PtrVal& q) {
+    if (!contains(p)) parent = parent.set(p, p);
+    if (!contains(q)) parent = parent.set(q, q);
     auto root_p = find(p);
     auto root_q = find(q);
     if (root_p == root_q) return;
-    auto tmp = next[root_p];
-    next.set(root_p, next[root_q]);
-    next.set(root_q, tmp);
-    if (size[root_p] < size[root_q]) {
-      parent.set(root_p, root_q);
-      size.update(root_q, [&](auto s) { return s + size[root_p]; });
-    } else {
-      parent.set(root_q, root_p);
-      size.update(root_p, [&](auto s) { return s + size[root_q]; });
+    auto size_p = size_of(root_p), size_q = size_of(root_q);
+    if (size_p < size_q) std::swap(root_p, root_q);
+    parent = parent.set(root_q, root_p);
+    size = size.set(root_p, size_p + size_q).erase(root_q);
+    if (auto ts = terms.find(root_q)) {
+      auto ts_p = terms.find(root_p);
+      terms = terms.set(root_p, ts_p ? *ts_p + *ts : *ts).erase(root_q);
+    }
+  }
+
+  // Joins term `e` with each of its variables
+  void join(const VarSet& vars, const PtrVal& e) {
+    if (!contains(e)) {
+      parent = parent.set(e, e);
+      terms = terms.set(e, List<PtrVal>{ e });
     }
+    for (auto v : vars) join(v, e);
+  }
+
+  // The terms of the class of `v`
+  const List<PtrVal>& terms_of(const PtrVal& v) const { return terms[find(v)]; }
+
+  // Calls `f` on the terms of the classes of `vars`, that is the terms that a
+  // term over `vars` would be joined with
+  template <typename F>
+  void for_each_term(const VarSet& vars, F f) const {
+    thread_local std::vector<PtrVal> roots;
+    roots.clear();
+    for (auto v : vars) roots.push_back(find(v));
+    std::sort(roots.begin(), roots.end(), [](auto& a, auto& b) { return a.bits() < b.bits(); });
+    roots.erase(std::unique(roots.begin(), roots.end()), roots.end());
+    for (auto& r : roots) {
+      if (auto ts = terms.find(r)) for (auto& t : *ts) f(t);
+    }
+  }
+
+  void print_set(const PtrVal& v) const {
+    for (auto& t : terms_of(v)) std::cout << *t << ", ";
+    std::cout << "\n";
   }
 };
 
-#endif
\ No newline at end of file
+#endif
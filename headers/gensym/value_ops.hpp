@@ -8,8 +8,89 @@ struct LocV;
 struct SymLocV;
 struct FloatV;
 struct ShadowV;
+struct StructV;
 struct SS;
 class PC;
+struct GCMarker;
+
+/* Kind tags of value representations */
+
+// Every Value carries the tag of its concrete representation, so that
+// down-casting and equality checks on the hot path do not need RTTI.
+enum class VKind : uint8_t { IntV, LocV, FunV, FloatV, SymV, SymLocV, StructV, ShadowV };
+
+// Per-kind hash seeds, so that constructing a value doesn't hash a kind name
+namespace hash_seed {
+  inline constexpr size_t IntV    = 0x9ae16a3b2f90404full;
+  inline constexpr size_t FloatV  = 0xc3a5c85c97cb3127ull;
+  inline constexpr size_t LocV    = 0xb492b66fbe98f273ull;
+  inline constexpr size_t FunV    = 0x9ddfea08eb382d69ull;
+  inline constexpr size_t SymVar  = 0xcbf29ce484222325ull;
+  inline constexpr size_t SymOp   = 0x87c37b91114253d5ull;
+  inline constexpr size_t SymLocV = 0x4cf5ad432745937full;
+  inline constexpr size_t StructV = 0x52dce729da3ed4a9ull;
+}
+
+// `value_kind<T>::test(k)` decides whether a value of kind `k` is a T
+// (including T's subclasses). Types without a specialization (e.g. FunV<func_t>,
+// whose instances differ in func_t) fall back to dynamic_cast.
+template <typename T> struct value_kind { static constexpr bool tagged = false; };
+template <> struct value_kind<IntV> {
+  static constexpr bool tagged = true;
+  static bool test(VKind k) { return k == VKind::IntV || k == VKind::LocV || k == VKind::FunV; }
+};
+template <> struct value_kind<LocV> {
+  static constexpr bool tagged = true;
+  static bool test(VKind k) { return k == VKind::LocV || k == VKind::FunV; }
+};
+template <> struct value_kind<FloatV> {
+  static constexpr bool tagged = true;
+  static bool test(VKind k) { return k == VKind::FloatV; }
+};
+template <> struct value_kind<SymV> {
+  static constexpr bool tagged = true;
+  static bool test(VKind k) { return k == VKind::SymV || k == VKind::SymLocV; }
+};
+template <> struct value_kind<SymLocV> {
+  static constexpr bool tagged = true;
+  static bool test(VKind k) { return k == VKind::SymLocV; }
+};
+template <> struct value_kind<StructV> {
+  static constexpr bool tagged = true;
+  static bool test(VKind k) { return k == VKind::StructV; }
+};
+template <> struct value_kind<ShadowV> {
+  static constexpr bool tagged = true;
+  static bool test(VKind k) { return k == VKind::ShadowV; }
+};
+
+/* Unboxed concrete integers */
+
+// A pointer whose lowest bit is set does not point to a Value, but is an
+// unboxed IntV that carries its data inline:
+//   bit 0: 1; bits 1-6: bw - 1; bits 7-63: the signed value (57 bits).
+// Integers that don't fit (or whose MSB-aligned data has non-zero low bits) are
+// boxed and hash-consed as before. Since the choice only depends on the value,
+// the encoding is canonical and pointer equality still coincides with equality.
+inline constexpr uintptr_t unboxed_tag = 1;
+inline constexpr size_t unboxed_buf_size = 64;
+
+// Returns 0 if (i, bw) can not be unboxed; `i` is MSB-aligned as in IntV.
+inline uintptr_t encode_unboxed_IntV(IntData i, size_t bw) {
+  if (bw == 0 || bw > 64) return 0;
+  if (bw < 64 && (uint64_t(i) << bw) != 0) return 0;
+  int64_t s = int64_t(i) >> (64 - bw);
+  if (s < -(int64_t(1) << 56) || s >= (int64_t(1) << 56)) return 0;
+  return (uint64_t(s) << 7) | ((bw - 1) << 1) | unboxed_tag;
+}
+inline size_t unboxed_bw(uintptr_t b) { return ((b >> 1) & 63) + 1; }
+inline int64_t unboxed_signed(uintptr_t b) { return int64_t(b) >> 7; }
+inline IntData unboxed_data(uintptr_t b) { return uint64_t(unboxed_signed(b)) << (64 - unboxed_bw(b)); }
+
+// Constructs a temporary IntV for an unboxed integer in the given buffer,
+// or in a small thread-local ring of buffers (only valid for a short while).
+inline Value* unbox_into(uintptr_t b, void* buf);
+inline Value* unbox_temp(uintptr_t b);
 
 template <typename T>
 struct simple_ptr {
@@ -18,11 +99,30 @@ public:
   simple_ptr(T* p): ptr(p) { }
   simple_ptr(): simple_ptr(nullptr) { }
   template<typename U, typename = std::enable_if_t<std::is_base_of_v<T, U>>>
-  simple_ptr(const simple_ptr<U> &rhs): simple_ptr(static_cast<T*>(rhs.get())) { }
+  simple_ptr(const simple_ptr<U> &rhs):
+    simple_ptr(rhs.is_unboxed() ? reinterpret_cast<T*>(rhs.ptr) : static_cast<T*>(rhs.ptr)) { }
   ~simple_ptr() { }
-  T* get() const { return ptr; }
-  T& operator*() const { return *ptr; }
-  T* operator->() const { return ptr; }
+
+  static simple_ptr from_bits(uintptr_t b) { return simple_ptr(reinterpret_cast<T*>(b)); }
+  uintptr_t bits() const { return reinterpret_cast<uintptr_t>(ptr); }
+  bool is_unboxed() const { return bits() & unboxed_tag; }
+
+  // `arrow` keeps the temporary IntV of an unboxed integer alive until the
+  // end of the full-expression containing `->`.
+  struct arrow {
+    T* p;
+    alignas(16) unsigned char buf[unboxed_buf_size];
+    arrow(const simple_ptr& sp):
+      p(sp.is_unboxed() ? reinterpret_cast<T*>(unbox_into(sp.bits(), buf)) : sp.ptr) { }
+    arrow(const arrow&) = delete;
+    T* operator->() const { return p; }
+  };
+
+  // Note: for an unboxed integer, `get` and `*` return a temporary that is
+  // only valid for a short while; avoid keeping them.
+  T* get() const { return is_unboxed() ? reinterpret_cast<T*>(unbox_temp(bits())) : ptr; }
+  T& operator*() const { return *get(); }
+  arrow operator->() const { return arrow(*this); }
   explicit operator bool() const { return bool(ptr); }
   bool operator<(const simple_ptr& rhs) const { return ptr < rhs.ptr; }
   bool operator!=(const simple_ptr& rhs) const { return ptr != rhs.ptr; }
@@ -49,18 +149,33 @@ simple_ptr<T> make_simple(Args&&... args) {
 namespace std {
   template<typename T, typename U>
   simple_ptr<T> dynamic_pointer_cast(simple_ptr<U> v) {
-    return simple_ptr<T>(dynamic_cast<T*>(v.get()));
+    if (v.is_unboxed()) {
+      if constexpr (value_kind<T>::tagged) {
+        if (value_kind<T>::test(VKind::IntV)) return simple_ptr<T>::from_bits(v.bits());
+        return simple_ptr<T>(nullptr);
+      } else {
+        if (dynamic_cast<T*>(v.get())) return simple_ptr<T>::from_bits(v.bits());
+        return simple_ptr<T>(nullptr);
+      }
+    }
+    if constexpr (value_kind<T>::tagged) {
+      if (v && value_kind<T>::test(v->kind)) return simple_ptr<T>(static_cast<T*>(v.get()));
+      return simple_ptr<T>(nullptr);
+    } else {
+      return simple_ptr<T>(dynamic_cast<T*>(v.get()));
+    }
   }
 
   template<typename T, typename U>
   simple_ptr<T> static_pointer_cast(simple_ptr<U> v) {
+    if (v.is_unboxed()) return simple_ptr<T>::from_bits(v.bits());
     return simple_ptr<T>(static_cast<T*>(v.get()));
   }
 
   template <typename T>
   struct hash<simple_ptr<T>> {
     size_t operator()(const simple_ptr<T> &rhs) const noexcept {
-      return hash<T*>{}(rhs.get());
+      return hash<uintptr_t>{}(rhs.bits());
     }
   };
 }
@@ -71,8 +186,19 @@ inline PtrVal bv_sext(const PtrVal& v, size_t bw);
 inline PtrVal bv_zext(const PtrVal& v, size_t bw);
 // XXX: when should we override toMSB? should document this behavior
 inline PtrVal make_IntV(IntData i, size_t bw=default_bw, bool toMSB=true);
-inline std::pair<bool, UIntData> get_sat_value(PC pc, PtrVal v);
+inline std::pair<bool, UIntData> get_sat_value(const PC& pc, PtrVal v);
+inline std::vector<UIntData> get_sat_values(const PC& pc, PtrVal v, size_t limit);
 inline PtrVal ite(const PtrVal& cond, const PtrVal& v_t, const PtrVal& v_e);
+inline PtrVal rewrite_SymV(iOP rator, const PtrVal* rands, size_t n, size_t bw);
+
+/* Reclamation state */
+
+// Values allocated before reclamation is armed (constants, globals, the
+// initial heap, etc.) are pinned and never reclaimed.
+inline constexpr uint32_t gc_pinned_mark = UINT32_MAX;
+inline std::atomic<bool> value_gc_armed = false;
+// The current marking epoch; a value is reachable iff its mark equals the epoch
+inline uint32_t value_gc_epoch = 0;
 
 /* Value representations */
 
@@ -96,25 +222,34 @@ struct Value : public enable_simple_from_this<Value>, public Printable {
   virtual List<PtrVal> to_bytes_shadow() = 0;
 
   size_t hashval;
-  Value() : hashval(0) {}
+  const VKind kind;
+  mutable uint32_t gc_mark;
+  Value(VKind kind) : hashval(0), kind(kind), gc_mark(value_gc_armed ? 0 : gc_pinned_mark) {}
+  Value(VKind kind, uint32_t mark) : hashval(0), kind(kind), gc_mark(mark) {}
+  virtual ~Value() {}
   size_t& hash() { return hashval; }
 
+  static void* operator new(size_t sz) { return value_arena().alloc(sz); }
+  static void operator delete(void* p, size_t sz) { value_arena().free(p, sz); }
+
+  // Note: the temporary IntV of an unboxed integer gives back the unboxed pointer
+  inline PtrVal shared_from_this();
+
+  /* `trace` marks the values directly referenced by this value. */
+  virtual void trace(GCMarker& /*m*/) const {}
+
   /* Note: these functions may return nullptr when the runtime type isn't the type being converted to. */
-  inline simple_ptr<IntV> to_IntV() { return std::dynamic_pointer_cast<IntV>(shared_from_this()); }
-  inline simple_ptr<SymV> to_SymV() { return std::dynamic_pointer_cast<SymV>(shared_from_this()); }
-  inline simple_ptr<LocV> to_LocV() { return std::dynamic_pointer_cast<LocV>(shared_from_this()); }
-  inline simple_ptr<FloatV> to_FloatV() { return std::dynamic_pointer_cast<FloatV>(shared_from_this()); }
-  inline simple_ptr<ShadowV> to_ShadowV() { return std::dynamic_pointer_cast<ShadowV>(shared_from_this()); }
+  inline simple_ptr<IntV> to_IntV();
+  inline simple_ptr<SymV> to_SymV();
+  inline simple_ptr<LocV> to_LocV();
+  inline simple_ptr<FloatV> to_FloatV();
+  inline simple_ptr<ShadowV> to_ShadowV();
 
   /* Since from_bytes/from_bytes_shadow only concate ``bit-vectors'' (either concrete or symbolic),
    * and they do not work with location/function values, at some point, we may find that
    * it doesn't make much sense to distinguish Int and Float as variants of Value...
    */
-  static PtrVal from_bytes(const List<PtrVal>& xs) {
-    // Note: it should work with a List of SymV/IntV, containing _no_ ShadowV/LocV/FunV
-    // XXX what if v is nullptr/padding
-    return Vec::foldRight(xs.take(xs.size()-1), xs.back(), [](auto&& x, auto&& acc) { return int_op_2(iOP::op_concat, acc, x); });
-  }
+  static PtrVal from_bytes(const List<PtrVal>& xs);
   static PtrVal from_bytes_shadow(const List<PtrVal>& xs) {
     // Note: it should work with a List of SymV/IntV/ShadowV, containing _no_ LocV/FunV.
     //       However, the head of xs should not be a Shadow V, if so the List is "incomplete".
@@ -149,35 +284,296 @@ inline std::ostream& operator<< <Value>(std::ostream& outs, const simple_ptr<Val
   return outs << rhs->toString();
 }
 
+// Hash of an operand: its structural hash, never its address, so that the
+// hash of a term is the same from run to run
+inline size_t hash_rand(const PtrVal& v) {
+  if (v.is_unboxed()) return std::hash<uintptr_t>{}(v.bits());
+  return v ? v->hash() : 0;
+}
+
+inline size_t hash_IntV(IntData i, size_t bw) {
+  size_t h = hash_seed::IntV;
+  hash_combine(h, i);
+  hash_combine(h, bw);
+  return h;
+}
+
+inline size_t hash_SymV(iOP rator, const PtrVal* rands, size_t n, size_t bw) {
+  size_t h = hash_seed::SymOp;
+  hash_combine(h, rator);
+  hash_combine(h, bw);
+  for (size_t i = 0; i < n; i++) hash_combine(h, hash_rand(rands[i]));
+  return h;
+}
+
+// Keys of boxed IntV and SymV operation nodes, used to look up an existing
+// value in the hash-consing pool before constructing (and allocating) one.
+struct IntVKey {
+  IntData i;
+  size_t bw;
+  size_t hash;
+  IntVKey(IntData i, size_t bw) : i(i), bw(bw), hash(hash_IntV(i, bw)) {}
+};
+
+struct SymVKey {
+  iOP rator;
+  const PtrVal* rands;
+  size_t n;
+  size_t bw;
+  size_t hash;
+  SymVKey(iOP rator, const PtrVal* rands, size_t n, size_t bw) :
+    rator(rator), rands(rands), n(n), bw(bw), hash(hash_SymV(rator, rands, n, bw)) {}
+};
+
+inline bool matches_key(const Value* v, const IntVKey& k);
+inline bool matches_key(const Value* v, const SymVKey& k);
+
 struct hash_PtrVal {
+  using is_transparent = void;
   size_t operator()(PtrVal const& v) const noexcept {
+    if (v.is_unboxed()) return std::hash<uintptr_t>{}(v.bits());
     return v ? v->hash() : std::hash<std::nullptr_t>{}(nullptr);
   }
+  size_t operator()(const IntVKey& k) const noexcept { return k.hash; }
+  size_t operator()(const SymVKey& k) const noexcept { return k.hash; }
 };
 
 struct equal_to_PtrVal {
+  using is_transparent = void;
+  template <typename K, typename = std::enable_if_t<!std::is_same_v<K, PtrVal>>>
+  bool operator()(PtrVal const& a, const K& k) const {
+    return a && !a.is_unboxed() && matches_key(a.get(), k);
+  }
+  template <typename K, typename = std::enable_if_t<!std::is_same_v<K, PtrVal>>>
+  bool operator()(const K& k, PtrVal const& a) const { return (*this)(a, k); }
   bool operator()(PtrVal const& a, PtrVal const& b) const {
-    if (!a || !b) return a == b;
-    if (std::type_index(typeid(*a)) != std::type_index(typeid(*b)))
+    if (!a || !b || a.is_unboxed() || b.is_unboxed()) return a == b;
+    if (a->kind != b->kind) return false;
+    // FunV instances of different func_t share a kind
+    if (a->kind == VKind::FunV && std::type_index(typeid(*a)) != std::type_index(typeid(*b)))
       return false;
     return a->compare(b.get());
   }
 };
 
-inline phmap::parallel_flat_hash_set<PtrVal,
-    hash_PtrVal,
-    equal_to_PtrVal,
-    std::allocator<PtrVal>,
-    4,
-    std::mutex> objpool;
+/* Hash-consing pool */
+
+// A small direct-mapped cache of recently interned values owned by one thread;
+// a hit takes no lock. Statistics are flushed to the global counters in batches.
+struct HashConsFront {
+  static constexpr size_t num_slots = 1024;
+  static constexpr uint64_t flush_period = 4096;
+  PtrVal slots[num_slots];
+  uint64_t lookups = 0, hits = 0, contended = 0;
+
+  void flush_stat() {
+    hashcons_lookups += lookups;
+    hashcons_front_hits += hits;
+    hashcons_contended += contended;
+    lookups = hits = contended = 0;
+  }
+};
+
+// Interned values live in a table split into independently locked shards,
+// selected by the (Fibonacci-mixed) hash of the value, with a HashConsFront
+// per thread in front of it.
+class HashConsPool {
+  using Shard = phmap::flat_hash_set<PtrVal, hash_PtrVal, equal_to_PtrVal>;
+  struct alignas(64) LockedShard {
+    std::mutex lock;
+    Shard set;
+  };
+  std::unique_ptr<LockedShard[]> shards;
+  size_t shard_bits;
+  std::mutex fronts_lock;
+  std::vector<HashConsFront*> fronts;
+
+  size_t shard_of(size_t h) const {
+    return shard_bits ? (uint64_t(h) * 0x9E3779B97F4A7C15ull) >> (64 - shard_bits) : 0;
+  }
+  size_t slot_of(size_t h) const { return (h ^ (h >> 17)) & (HashConsFront::num_slots - 1); }
+  HashConsFront& front() {
+    // Note: intentionally never destroyed, like the value arenas.
+    thread_local HashConsFront* f = nullptr;
+    if (!f) {
+      f = new HashConsFront;
+      const std::scoped_lock lock(fronts_lock);
+      fronts.push_back(f);
+    }
+    return *f;
+  }
+
+public:
+  HashConsPool(size_t n = 64) : shard_bits(0) { reshard(n); }
+
+  size_t shard_num() const { return size_t(1) << shard_bits; }
+
+  // Changes the number of shards (rounded up to a power of two), rehashing
+  // the existing values. Not thread-safe: only used while parsing options.
+  void reshard(size_t n) {
+    size_t bits = 0;
+    while ((size_t(1) << bits) < n) bits++;
+    auto old = std::move(shards);
+    size_t old_num = old ? shard_num() : 0;
+    shard_bits = bits;
+    shards.reset(new LockedShard[shard_num()]);
+    for (size_t i = 0; i < old_num; i++) {
+      for (auto& v : old[i].set) shards[shard_of(hash_PtrVal{}(v))].set.insert(v);
+    }
+  }
+
+  // Returns the canonical value equal to `v`; `v` is freed if one already exists.
+  PtrVal intern(const PtrVal& v) {
+    auto& f = front();
+    size_t h = hash_PtrVal{}(v);
+    auto& slot = f.slots[slot_of(h)];
+    if (++f.lookups == HashConsFront::flush_period) f.flush_stat();
+    if (slot && equal_to_PtrVal{}(slot, v)) {
+      f.hits++;
+      delete v.get();
+      return slot;
+    }
+    auto& s = shards[shard_of(h)];
+    if (!s.lock.try_lock()) {
+      f.contended++;
+      s.lock.lock();
+    }
+    auto [it, ins] = s.set.insert(v);
+    PtrVal ret = *it;
+    s.lock.unlock();
+    if (!ins) delete v.get();
+    slot = ret;
+    return ret;
+  }
+
+  // Finds the canonical value matching a key (IntVKey/SymVKey), or nullptr.
+  template <typename K>
+  PtrVal find(const K& k) {
+    auto& f = front();
+    auto& slot = f.slots[slot_of(k.hash)];
+    if (++f.lookups == HashConsFront::flush_period) f.flush_stat();
+    if (slot && equal_to_PtrVal{}(slot, k)) {
+      f.hits++;
+      return slot;
+    }
+    auto& s = shards[shard_of(k.hash)];
+    if (!s.lock.try_lock()) {
+      f.contended++;
+      s.lock.lock();
+    }
+    auto it = s.set.find(k);
+    PtrVal ret = (it != s.set.end()) ? *it : nullptr;
+    s.lock.unlock();
+    if (ret) slot = ret;
+    return ret;
+  }
+
+  size_t size() {
+    size_t n = 0;
+    for (size_t i = 0; i < shard_num(); i++) {
+      const std::scoped_lock lock(shards[i].lock);
+      n += shards[i].set.size();
+    }
+    return n;
+  }
+  bool contains(const PtrVal& v) {
+    auto& s = shards[shard_of(hash_PtrVal{}(v))];
+    const std::scoped_lock lock(s.lock);
+    return s.set.find(v) != s.set.end();
+  }
+
+  // The following are only used by the reclamation pass, while all
+  // other threads are parked.
+  template <typename F>
+  void for_each(F f) {
+    for (size_t i = 0; i < shard_num(); i++) {
+      for (auto& v : shards[i].set) f(v);
+    }
+  }
+  void erase(const PtrVal& v) { shards[shard_of(hash_PtrVal{}(v))].set.erase(v); }
+  void clear_fronts() {
+    const std::scoped_lock lock(fronts_lock);
+    for (auto f : fronts) {
+      for (auto& s : f->slots) s = nullptr;
+    }
+  }
+};
+
+inline HashConsPool objpool(hashcons_shards);
 
 inline PtrVal hashconsing(const PtrVal &ret) {
   if (!use_hashcons) return ret;
-  auto [ret2, ins] = objpool.insert(ret);
-  if (!ins) delete ret.get();
-  return *ret2;
+  return objpool.intern(ret);
 }
 
+/* Reclamation support */
+
+inline bool gc_is_live(const Value* v) {
+  return v->gc_mark == value_gc_epoch || v->gc_mark == gc_pinned_mark;
+}
+
+inline bool gc_is_live(const PtrVal& v) { return !v || v.is_unboxed() || gc_is_live(v.get()); }
+
+// Marks all values transitively reachable from the given roots in the current epoch.
+struct GCMarker {
+  std::vector<const Value*> worklist;
+
+  void mark(const PtrVal& v) {
+    if (!v || v.is_unboxed() || gc_is_live(v.get())) return;
+    v->gc_mark = value_gc_epoch;
+    worklist.push_back(v.get());
+  }
+  template <typename C>
+  void mark_all(const C& vs) {
+    for (auto& v : vs) mark(v);
+  }
+  void drain() {
+    while (!worklist.empty()) {
+      auto v = worklist.back();
+      worklist.pop_back();
+      v->trace(*this);
+    }
+  }
+};
+
+// Registry of objects (i.e. symbolic states) whose values are the roots of a
+// reclamation pass. An object only registers itself when reclamation is armed,
+// so this costs nothing otherwise. S has to define `void trace(GCMarker&) const`.
+template <typename S>
+class GCRoot {
+  static constexpr size_t num_shards = 16;
+  static inline std::mutex locks[num_shards];
+  static inline std::unordered_set<const GCRoot*> roots[num_shards];
+  bool tracked;
+
+  size_t shard() const { return std::hash<const GCRoot*>{}(this) % num_shards; }
+  void enter() {
+    tracked = value_gc_armed;
+    if (!tracked) return;
+    const std::scoped_lock lock(locks[shard()]);
+    roots[shard()].insert(this);
+  }
+  void leave() {
+    if (!tracked) return;
+    const std::scoped_lock lock(locks[shard()]);
+    roots[shard()].erase(this);
+  }
+public:
+  GCRoot() { enter(); }
+  GCRoot(const GCRoot&) { enter(); }
+  GCRoot(GCRoot&&) { enter(); }
+  GCRoot& operator=(const GCRoot&) { return *this; }
+  GCRoot& operator=(GCRoot&&) { return *this; }
+  ~GCRoot() { leave(); }
+
+  static void trace_all(GCMarker& m) {
+    for (size_t i = 0; i < num_shards; i++) {
+      const std::scoped_lock lock(locks[i]);
+      for (auto r : roots[i]) static_cast<const S*>(r)->trace(m);
+    }
+  }
+};
+
 // Uninitialized value
 inline PtrVal make_UnInitV() {
   static PtrVal UnInitV = make_IntV(0, 8);
@@ -186,8 +582,8 @@ inline PtrVal make_UnInitV() {
 
 struct ShadowV : public Value {
   int8_t offset;
-  ShadowV() : offset(0) {}
-  ShadowV(int8_t offset) : offset(offset) {}
+  ShadowV() : Value(VKind::ShadowV), offset(0) {}
+  ShadowV(int8_t offset) : Value(VKind::ShadowV), offset(offset) {}
   virtual bool is_conc() const { return true; };
   virtual size_t get_bw() const { return 0; }
   virtual bool compare(const Value* v) const { return false; }
@@ -228,12 +624,13 @@ inline List<PtrVal> make_ShadowV_seq(int8_t size) {
 struct IntV : Value {
   size_t bw;
   IntData i;
-  IntV(IntData i, size_t bw) : i(i), bw(bw) {
-    hash_combine(hash(), std::string("intv"));
-    hash_combine(hash(), i);
-    hash_combine(hash(), bw);
+  IntV(IntData i, size_t bw, VKind kind = VKind::IntV) : Value(kind), i(i), bw(bw) {
+    hash() = hash_IntV(i, bw);
   }
   IntV(const IntV& v) : IntV(v.i, v.bw) {}
+  // The temporary of an unboxed integer, not hashed
+  struct unboxed_t {};
+  IntV(IntData i, size_t bw, unboxed_t) : Value(VKind::IntV, gc_pinned_mark), i(i), bw(bw) {}
   std::string toString() const override {
     std::ostringstream ss;
     ss << "IntV(" << as_signed() << ", " << bw << ")";
@@ -264,13 +661,47 @@ struct IntV : Value {
   }
 };
 
+static_assert(sizeof(IntV) <= unboxed_buf_size, "unboxed IntV buffer too small");
+
+inline Value* unbox_into(uintptr_t b, void* buf) {
+  return ::new (buf) IntV(unboxed_data(b), unboxed_bw(b), IntV::unboxed_t{});
+}
+
+inline Value* unbox_temp(uintptr_t b) {
+  alignas(16) thread_local unsigned char ring[16][unboxed_buf_size];
+  thread_local unsigned next = 0;
+  return unbox_into(b, ring[next++ % 16]);
+}
+
+inline PtrVal Value::shared_from_this() {
+  if (kind == VKind::IntV) {
+    auto iv = static_cast<IntV*>(this);
+    if (auto b = encode_unboxed_IntV(iv->i, iv->bw)) return PtrVal::from_bits(b);
+  }
+  return PtrVal(this);
+}
+
 inline PtrVal make_IntV(IntData i, size_t bw, bool toMSB) {
   ASSERT(bw > 0, "Making an integer of size 0");
-  auto ret = make_simple<IntV>(toMSB ? (i << (addr_bw - bw)) : i, bw);
+  IntData data = toMSB ? (i << (addr_bw - bw)) : i;
+  if (auto b = encode_unboxed_IntV(data, bw)) return PtrVal::from_bits(b);
+  if (use_hashcons) {
+    if (auto found = objpool.find(IntVKey(data, bw))) return found;
+  }
+  auto ret = make_simple<IntV>(data, bw);
   return hashconsing(ret);
 }
 
+// Bitwidth of a value, without materializing unboxed integers
+inline size_t bw_of(const PtrVal& v) {
+  return v.is_unboxed() ? unboxed_bw(v.bits()) : v->get_bw();
+}
+
 inline IntData proj_IntV(const PtrVal& v) {
+  if (v.is_unboxed()) {
+    auto s = unboxed_signed(v.bits());
+    return unboxed_bw(v.bits()) == 1 ? (s ? 1 : 0) : s;
+  }
   if (v->get_bw() == 1) return v->to_IntV()->i ? 1 : 0;
   return v->to_IntV()->as_signed();
 }
@@ -284,8 +715,8 @@ inline char proj_IntV_char(const PtrVal& v) {
 struct FloatV : Value {
   long double f;
   size_t bw;
-  FloatV(long double f, size_t bw=32) : f(f), bw(bw) {
-    hash_combine(hash(), std::string("floatv"));
+  FloatV(long double f, size_t bw=32) : Value(VKind::FloatV), f(f), bw(bw) {
+    hash() = hash_seed::FloatV;
     hash_combine(hash(), f);
     hash_combine(hash(), bw);
   }
@@ -361,9 +792,9 @@ struct LocV : IntV {
   Kind k;
   size_t base, size; // the base point and its valid extent
 
-  LocV(Addr base, Kind k, int size, int off) :
-    IntV(MemOffset[k] + base + off, 64), l(base + off), k(k), base(base), size(size) {
-    hash_combine(hash(), std::string("locv"));
+  LocV(Addr base, Kind k, int size, int off, VKind kind = VKind::LocV) :
+    IntV(MemOffset[k] + base + off, 64, kind), l(base + off), k(k), base(base), size(size) {
+    hash_combine(hash(), hash_seed::LocV);
     hash_combine(hash(), k);
     hash_combine(hash(), l);
     hash_combine(hash(), base);
@@ -429,9 +860,9 @@ inline size_t get_pointer_realsize(const PtrVal& v) {
 template <typename func_t>
 struct FunV : LocV {
   func_t f;
-  FunV(func_t f) : LocV(static_cast<Addr>(reinterpret_cast<intptr_t>(f)), LocV::kNative, 1, 0), f(f) {
+  FunV(func_t f) : LocV(static_cast<Addr>(reinterpret_cast<intptr_t>(f)), LocV::kNative, 1, 0, VKind::FunV), f(f) {
     ASSERT(f != nullptr, "funv cannot be nullptr");
-    hash_combine(hash(), std::string("funv"));
+    hash_combine(hash(), hash_seed::FunV);
     hash_combine(hash(), f);
   }
   std::string toString() const override {
@@ -445,6 +876,11 @@ struct FunV : LocV {
   }
 };
 
+#include "varset.hpp"
+#include "bvdomain.hpp"
+
+inline BVDomain dom_of(const PtrVal& v);
+
 struct SymV : Value {
   String name;
   size_t bw;
@@ -452,29 +888,35 @@ struct SymV : Value {
   uint32_t id;
   uint32_t term_size;
   immer::array<PtrVal> rands;
-  immer::set_transient<PtrVal> vars;
+  VarSet vars;
+  BVDomain dom; // the values this term may take
 
-  SymV(String name, size_t bw) : name(name), bw(bw), id(g_sym_id++), term_size(1) {
-    hash_combine(hash(), std::string("symv1"));
+  SymV(String name, size_t bw) : Value(VKind::SymV), name(name), bw(bw), id(g_sym_id++), term_size(1) {
+    hash() = hash_seed::SymVar;
     hash_combine(hash(), name);
     hash_combine(hash(), bw);
-    vars.insert(shared_from_this()->to_SymV());
+    vars = VarSet::single(var_table.id_of(name, bw));
+    dom = BVDomain::top(bw);
   }
-  SymV(iOP rator, immer::array<PtrVal> rands, size_t bw) : rator(rator), rands(rands), bw(bw), id(g_sym_id++) {
-    hash_combine(hash(), std::string("symv2"));
-    hash_combine(hash(), rator);
-    hash_combine(hash(), bw);
+  SymV(iOP rator, immer::array<PtrVal> rands, size_t bw, VKind kind = VKind::SymV) :
+    Value(kind), rator(rator), rands(rands), bw(bw), id(g_sym_id++) {
+    hash() = hash_SymV(rator, rands.data(), rands.size(), bw);
     term_size = 1;
+    BVDomain doms[3];
+    size_t bws[3];
+    size_t k = 0;
     for (auto& r: rands) {
-      hash_combine(hash(), std::hash<PtrVal>{}(r));
-      auto sym_rand = r->to_SymV();
+      auto sym_rand = std::dynamic_pointer_cast<SymV>(r);
       if (sym_rand) {
         term_size += sym_rand->term_size;
-        for (auto& v : sym_rand->vars) vars.insert(v);
+        vars = vars | sym_rand->vars;
       } else {
         term_size += 1;
       }
+      if (k < 3) { doms[k] = dom_of(r); bws[k] = bw_of(r); }
+      k++;
     }
+    dom = k <= 3 ? bvdomain::transfer(rator, doms, bws, k, bw) : BVDomain::top(bw);
   }
   std::ostream& pprint(std::ostream& os, int level) const {
     String padding(level, ' ');
@@ -506,6 +948,8 @@ struct SymV : Value {
   }
   inline const PtrVal& operator[](std::size_t idx) const { return rands[idx]; }
 
+  virtual void trace(GCMarker& m) const override { m.mark_all(rands); }
+
   virtual bool is_conc() const override { return false; }
   virtual size_t get_bw() const override { return bw; }
 
@@ -530,65 +974,75 @@ struct SymV : Value {
     return List<PtrVal>{shared_from_this()} + make_ShadowV_seq(bw/8 - 1);
   }
 
-  static PtrVal simplify(iOP& rator, immer::array<PtrVal>& rands, size_t& bw) {
-    auto arg0 = rands[0]->to_SymV();
-    if (rator == iOP::op_neg && arg0) {
-      switch (arg0->rator) {
-        case iOP::op_neq: return make_simple<SymV>(iOP::op_eq, arg0->rands, bw);
-        case iOP::op_eq:  return make_simple<SymV>(iOP::op_neq, arg0->rands, bw);
-        case iOP::op_sle: return make_simple<SymV>(iOP::op_sgt, arg0->rands, bw);
-        case iOP::op_slt: return make_simple<SymV>(iOP::op_sge, arg0->rands, bw);
-        case iOP::op_sge: return make_simple<SymV>(iOP::op_slt, arg0->rands, bw);
-        case iOP::op_sgt: return make_simple<SymV>(iOP::op_sle, arg0->rands, bw);
-        case iOP::op_ule: return make_simple<SymV>(iOP::op_ugt, arg0->rands, bw);
-        case iOP::op_ult: return make_simple<SymV>(iOP::op_uge, arg0->rands, bw);
-        case iOP::op_uge: return make_simple<SymV>(iOP::op_ult, arg0->rands, bw);
-        case iOP::op_ugt: return make_simple<SymV>(iOP::op_ule, arg0->rands, bw);
-      }
-    } else if (rator == iOP::op_neq && arg0) {
-      // TODO: see if they can be implemented in front-end
-      auto arg1 = rands[1]->to_IntV();
-      if (arg0->rator == iOP::op_zext) {
-        auto bw1 = arg0->rands[0]->get_bw();
-        // zext(sym(x,bw1), bw2) != IntV(n, bw2)) if 0 <= n < 2^bw1 =>
-        // sym(x, bw1) != IntV(n, bw1)
-        if (arg1 && arg0->bw == arg1->bw &&
-            0 <= arg1->i && arg1->i < (1 << bw1)) {
-          return make_simple<SymV>(iOP::op_neq, immer::array({arg0->rands[0], make_IntV(arg1->i, bw1)}), bw);
-        }
-      }
-      if (arg0->rator == iOP::op_sext) {
-        auto bw1 = arg0->rands[0]->get_bw();
-        // sext(sym(x,bw1), bw2) != IntV(n, bw2)) if -2^{bw1-1} <= n < 2^{bw1-1} =>
-        // sym(x, bw1) != IntV(n, bw1)
-        if (arg1 && arg0->bw == arg1->bw &&
-            -(1 << (bw1-1)) <= arg1->i && arg1->i < (1 << (bw1-1))) {
-          return make_simple<SymV>(iOP::op_neq, immer::array({arg0->rands[0], make_IntV(arg1->i, bw1)}), bw);
-        }
-      }
-    }
-    return nullptr;
-  }
-
   static PtrVal neg(const PtrVal& v);
 };
 
-inline PtrVal make_SymV(const String& n) {
-  auto ret = make_simple<SymV>(n, default_bw);
-  return hashconsing(ret);
+inline bool matches_key(const Value* v, const IntVKey& k) {
+  if (v->kind != VKind::IntV) return false;
+  auto iv = static_cast<const IntV*>(v);
+  return iv->i == k.i && iv->bw == k.bw;
+}
+
+inline bool matches_key(const Value* v, const SymVKey& k) {
+  if (v->kind != VKind::SymV) return false;
+  auto sv = static_cast<const SymV*>(v);
+  if (!sv->name.empty() || sv->rator != k.rator || sv->bw != k.bw || sv->rands.size() != k.n)
+    return false;
+  for (size_t i = 0; i < k.n; i++) {
+    if (sv->rands[i] != k.rands[i]) return false;
+  }
+  return true;
+}
+
+inline BVDomain dom_of(const PtrVal& v) {
+  if (v.is_unboxed()) {
+    auto bw = unboxed_bw(v.bits());
+    return BVDomain::constant(uint64_t(unboxed_data(v.bits())) >> (64 - bw), bw);
+  }
+  switch (v.get()->kind) {
+    case VKind::IntV: {
+      auto i = static_cast<const IntV*>(v.get());
+      // Note: booleans are not always MSB-aligned, as in proj_IntV
+      if (i->bw == 1) return BVDomain::constant(i->i != 0, 1);
+      return BVDomain::constant(uint64_t(i->i) >> (64 - i->bw), i->bw);
+    }
+    case VKind::SymV: case VKind::SymLocV:
+      return static_cast<const SymV*>(v.get())->dom;
+    default:
+      return BVDomain::top(bw_of(v));
+  }
 }
 
 inline PtrVal make_SymV(const String n, size_t bw) {
-  auto ret = make_simple<SymV>(n, bw);
-  return hashconsing(ret);
+  auto ret = hashconsing(make_simple<SymV>(n, bw));
+  var_table.publish(*static_cast<SymV*>(ret.get())->vars.ids_begin(), ret);
+  return ret;
+}
+
+inline PtrVal make_SymV(const String& n) {
+  return make_SymV(n, default_bw);
 }
 
 inline PtrVal make_SymV(iOP rator, immer::array<PtrVal> rands, size_t bw) {
-  //std::cout << "Trying to simplify " << make_simple<SymV>(rator, rands, bw)->toString() << "\n";
-  PtrVal ret = nullptr;
-  if (use_symv_simplify) ret = SymV::simplify(rator, rands, bw);
-  if (!ret) ret = make_simple<SymV>(rator, std::move(rands), bw);
-  return hashconsing(ret);
+  if (use_hashcons) {
+    if (auto found = objpool.find(SymVKey(rator, rands.data(), rands.size(), bw))) return found;
+  }
+  if (use_symv_simplify) {
+    if (auto ret = rewrite_SymV(rator, rands.data(), rands.size(), bw)) return ret;
+  }
+  return hashconsing(make_simple<SymV>(rator, std::move(rands), bw));
+}
+
+// Picked for braced operands, e.g. make_SymV(op, { v1, v2 }, bw), so that the
+// operand array is only built if the node doesn't exist yet.
+inline PtrVal make_SymV(iOP rator, std::initializer_list<PtrVal> rands, size_t bw) {
+  if (use_hashcons) {
+    if (auto found = objpool.find(SymVKey(rator, rands.begin(), rands.size(), bw))) return found;
+  }
+  if (use_symv_simplify) {
+    if (auto ret = rewrite_SymV(rator, rands.begin(), rands.size(), bw)) return ret;
+  }
+  return hashconsing(make_simple<SymV>(rator, immer::array<PtrVal>(rands), bw));
 }
 
 // return a list of `n` SymV with the specified variable name prefix
@@ -623,10 +1077,10 @@ struct SymLocV : SymV {
   size_t base, size;
 
   SymLocV(Addr base, LocV::Kind k, int size, PtrVal off) :
-    SymV(iOP::op_add, { bv_sext(off, addr_bw), make_IntV((LocV::MemOffset[k] + base), addr_bw) }, addr_bw),
+    SymV(iOP::op_add, { bv_sext(off, addr_bw), make_IntV((LocV::MemOffset[k] + base), addr_bw) }, addr_bw, VKind::SymLocV),
     off(addr_index_ext(off)), k(k), base(base), size(size) {
-    hash_combine(hash(), std::string("symlocv"));
-    hash_combine(hash(), std::hash<PtrVal>{}(off));
+    hash_combine(hash(), hash_seed::SymLocV);
+    hash_combine(hash(), hash_rand(off));
     hash_combine(hash(), k);
     hash_combine(hash(), base);
     hash_combine(hash(), size);
@@ -634,6 +1088,11 @@ struct SymLocV : SymV {
 
   SymLocV(const SymLocV& v) : SymLocV(v.base, v.k, v.size, v.off) {}
 
+  virtual void trace(GCMarker& m) const override {
+    SymV::trace(m);
+    m.mark(off);
+  }
+
   std::string toString() const override {
     std::ostringstream ss;
     ss << "LocV(off:" << *off << ", " << "base:" << base << ", size:" << size
@@ -657,19 +1116,20 @@ inline PtrVal make_SymLocV(Addr base, LocV::Kind k, size_t size, PtrVal off) {
 
 struct StructV : Value {
   immer::flex_vector<PtrVal> fs;
-  StructV(immer::flex_vector<PtrVal> fs) : fs(fs) {
-    hash_combine(hash(), std::string("structv"));
-    for (auto &f: fs) hash_combine(hash(), std::hash<PtrVal>{}(f));
+  StructV(immer::flex_vector<PtrVal> fs) : Value(VKind::StructV), fs(fs) {
+    hash() = hash_seed::StructV;
+    for (auto &f: fs) hash_combine(hash(), hash_rand(f));
   }
-  StructV(std::vector<PtrVal> fs) : fs(fs.begin(), fs.end()) {
-    hash_combine(hash(), std::string("structv"));
-    for (auto &f: fs) hash_combine(hash(), std::hash<PtrVal>{}(f));
+  StructV(std::vector<PtrVal> fs) : Value(VKind::StructV), fs(fs.begin(), fs.end()) {
+    hash() = hash_seed::StructV;
+    for (auto &f: fs) hash_combine(hash(), hash_rand(f));
   }
   std::string toString() const override {
     std::ostringstream ss;
     ss << "StructV(..)";
     return ss.str();
   }
+  virtual void trace(GCMarker& m) const override { m.mark_all(fs); }
   virtual bool is_conc() const override {
     ABORT("is_conc: unexpected value StructV.");
   }
@@ -684,6 +1144,12 @@ struct StructV : Value {
   virtual List<PtrVal> to_bytes_shadow() { ABORT("???"); }
 };
 
+inline simple_ptr<IntV> Value::to_IntV() { return std::dynamic_pointer_cast<IntV>(shared_from_this()); }
+inline simple_ptr<SymV> Value::to_SymV() { return std::dynamic_pointer_cast<SymV>(shared_from_this()); }
+inline simple_ptr<LocV> Value::to_LocV() { return std::dynamic_pointer_cast<LocV>(shared_from_this()); }
+inline simple_ptr<FloatV> Value::to_FloatV() { return std::dynamic_pointer_cast<FloatV>(shared_from_this()); }
+inline simple_ptr<ShadowV> Value::to_ShadowV() { return std::dynamic_pointer_cast<ShadowV>(shared_from_this()); }
+
 inline PtrVal structV_at(const PtrVal& v, int idx) {
   auto sv = std::dynamic_pointer_cast<StructV>(v);
   if (sv) return (sv->fs).at(idx);
@@ -701,7 +1167,7 @@ inline PtrVal int_op_1(iOP op, const PtrVal& v, immer::array<size_t> params = {}
   if (i) {
     switch (op) {
       case iOP::op_neg: return make_IntV(!i->i, bw);
-      case iOP::op_bvnot: return make_IntV(~i->i, bw);
+      case iOP::op_bvnot: return make_IntV(~uint64_t(i->i) >> (addr_bw - bw), bw);
       case iOP::op_sext: {
         auto to_bw = params[0];
         return make_IntV(int64_t(i->i) >> (to_bw - i->bw), to_bw, false);
@@ -754,10 +1220,10 @@ inline PtrVal trunc(const PtrVal& v1, int from, int to) {
 // assume all values are signed, convert to unsigned if necessary
 // require return value to be signed or non-negative
 inline PtrVal int_op_2(iOP op, const PtrVal& v1, const PtrVal& v2) {
-  auto i1 = v1->to_IntV();
-  auto i2 = v2->to_IntV();
-  auto bw1 = v1->get_bw();
-  auto bw2 = v2->get_bw();
+  auto i1 = std::dynamic_pointer_cast<IntV>(v1);
+  auto i2 = std::dynamic_pointer_cast<IntV>(v2);
+  auto bw1 = bw_of(v1);
+  auto bw2 = bw_of(v2);
   if (op != iOP::op_concat && bw1 != bw2) {
     std::cout << *v1 << " " << int_op_string(op) << " " << *v2 << "\n";
     ABORT("int_op_2: bitwidth of operands mismatch");
@@ -818,8 +1284,8 @@ inline PtrVal int_op_2(iOP op, const PtrVal& v1, const PtrVal& v2) {
         ABORT("invalid operator");
     }
   } else {
-    auto sym1 = v1->to_SymV();
-    auto sym2 = v2->to_SymV();
+    auto sym1 = std::dynamic_pointer_cast<SymV>(v1);
+    auto sym2 = std::dynamic_pointer_cast<SymV>(v2);
     ASSERT((i1 || sym1) && (i2 || sym2), "Invalid operand");
     auto bw = bw1;
     if ((sym1 && iOP::op_ite == sym1->rator) && (sym2 && iOP::op_ite == sym2->rator) && ((*sym1)[0] == (*sym2)[0])) {
@@ -875,6 +1341,133 @@ inline PtrVal bv_extract(const PtrVal& v1, int hi, int lo) {
   ABORT("Extract an invalid value, exit");
 }
 
+/* Reassembly of multi-byte values */
+
+// Builds the concatenation of bit ranges of values, given from the least
+// significant one. Adjacent ranges of the same value (seeing through extracts)
+// are merged into one extract, or the value itself if it is complete, and
+// adjacent concrete ranges are folded into one integer, so that reading back
+// a word stored byte by byte gives the word instead of a chain of concats.
+class WordAssembler {
+  PtrVal acc;          // the less significant part, already assembled
+  PtrVal src;          // the pending range [lo, hi] of src
+  int hi = 0, lo = 0;
+  uint64_t conc = 0;   // the pending concrete bits
+  size_t conc_bw = 0;
+
+  void append(const PtrVal& v) {
+    acc = acc ? int_op_2(iOP::op_concat, v, acc) : v;
+  }
+  void flush() {
+    if (conc_bw > 0) {
+      append(make_IntV(conc, conc_bw));
+      conc_bw = 0;
+    }
+    if (src) {
+      append((lo == 0 && hi + 1 == int(bw_of(src))) ? src : bv_extract(src, hi, lo));
+      src = nullptr;
+    }
+  }
+
+public:
+  // Appends the bits [lo, hi] of v above the ones appended so far
+  void push(const PtrVal& v, int hi, int lo) {
+    size_t bw = hi - lo + 1;
+    if (v.is_unboxed() || v->kind == VKind::IntV) {
+      IntData d = v.is_unboxed() ? unboxed_data(v.bits()) : static_cast<IntV*>(v.get())->i;
+      auto bits = uint64_t(d) << (bw_of(v) - hi - 1) >> (addr_bw - bw);
+      if (src || conc_bw + bw > addr_bw) flush();
+      if (conc_bw == 0) conc = 0;
+      conc |= bits << conc_bw;
+      conc_bw += bw;
+      return;
+    }
+    if (v->kind == VKind::SymV) {
+      auto s = static_cast<SymV*>(v.get());
+      if (s->name.empty() && s->rator == iOP::op_extract) {
+        int base = proj_IntV(s->rands[2]);
+        return push(s->rands[0], hi + base, lo + base);
+      }
+      if (s->name.empty() && s->rator == iOP::op_concat) {
+        // the parts of a (previously assembled) word are pushed separately
+        int bwl = bw_of(s->rands[1]);
+        if (lo < bwl) push(s->rands[1], std::min(hi, bwl - 1), lo);
+        if (hi >= bwl) push(s->rands[0], hi - bwl, std::max(lo, bwl) - bwl);
+        return;
+      }
+    }
+    if (src && src == v && this->hi + 1 == lo) {
+      this->hi = hi;
+      return;
+    }
+    flush();
+    src = v;
+    this->hi = hi;
+    this->lo = lo;
+  }
+  void push(const PtrVal& v) { push(v, bw_of(v) - 1, 0); }
+
+  PtrVal finish() {
+    flush();
+    return acc;
+  }
+};
+
+inline PtrVal Value::from_bytes(const List<PtrVal>& xs) {
+  // Note: it should work with a List of SymV/IntV, containing _no_ ShadowV/LocV/FunV
+  // XXX what if v is nullptr/padding
+  WordAssembler word;
+  for (auto& x : xs) word.push(x);
+  return word.finish();
+}
+
+/* Objects read at symbolic offsets as arrays (--symloc-strategy=array) */
+
+// The bytes of an object are an op_array node, with one 8-bit operand per
+// byte, and a byte of it at an index is an op_select node. The solvers turn
+// them into array terms (stores of the bytes, and a read) only when they are
+// queried, instead of an ite arm per possible offset. Reads out of the object
+// are 0.
+
+// The array of the `size` bytes of an object, where `cell(i)` is the value
+// starting at byte i (or ShadowV/nullptr) and `byte(i)` the byte i, or nullptr
+// if the object holds values other than bitvectors (e.g. pointers).
+template <typename Cell, typename Byte>
+inline PtrVal make_object_array(size_t size, Cell cell, Byte byte) {
+  std::vector<PtrVal> bytes(size);
+  for (size_t i = 0; i < size; i++) {
+    auto c = cell(i);
+    if (c && !c.is_unboxed() && c->kind != VKind::IntV && c->kind != VKind::SymV && c->kind != VKind::ShadowV)
+      return nullptr;
+    PtrVal b = c ? byte(i) : nullptr;
+    if (!b) b = make_IntV(0, 8);
+    if (!b.is_unboxed() && b->kind != VKind::IntV && b->kind != VKind::SymV) return nullptr;
+    auto bw = bw_of(b);
+    if (bw < 8) b = bv_zext(b, 8);
+    else if (bw != 8) return nullptr;
+    bytes[i] = b;
+  }
+  return make_SymV(iOP::op_array, immer::array<PtrVal>(bytes.begin(), bytes.end()), 8);
+}
+
+inline PtrVal bv_select(const PtrVal& arr, const PtrVal& idx) {
+  ASSERT(bw_of(idx) == addr_index_bw, "Invalid array index");
+  auto d = dom_of(idx);
+  if (d.is_const()) {
+    auto& bytes = static_cast<const SymV*>(arr.get())->rands;
+    return d.lo < bytes.size() ? bytes[d.lo] : make_IntV(0, 8);
+  }
+  return make_SymV(iOP::op_select, { arr, idx }, 8);
+}
+
+// Reads `size` bytes (little-endian) of the array at offset `off`
+inline PtrVal array_read(const PtrVal& arr, const PtrVal& off, size_t size) {
+  WordAssembler word;
+  for (size_t i = 0; i < size; i++)
+    word.push(bv_select(arr, i == 0 ? off : int_op_2(iOP::op_add, off, make_IntV(i, addr_index_bw))));
+  return word.finish();
+}
+
 inline PtrVal float_op_2(fOP op, const PtrVal& v1, const PtrVal& v2) {
   auto f1 = v1->to_FloatV();
   auto f2 = v2->to_FloatV();
@@ -0,0 +1,186 @@
+#ifndef GS_VARSET_HEADER
+#define GS_VARSET_HEADER
+
+/* Interned sets of symbolic variables */
+
+// Every variable (a named SymV) gets a dense id, and the variables of a SymV
+// are an interned, immutable, sorted array of ids. A node shares the set of
+// its operands whenever it can, and unions are memoized per thread, so that
+// constructing a term no longer copies the variables of all its operands.
+
+// Dense ids of variables, and the canonical variable of each id.
+class VarTable {
+  static constexpr size_t chunk_bits = 12;
+  static constexpr size_t chunk_size = size_t(1) << chunk_bits;
+  static constexpr size_t max_chunks = size_t(1) << 16;
+  using Slot = std::atomic<uintptr_t>;
+
+  std::mutex lock;
+  std::map<std::pair<String, size_t>, uint32_t> ids;
+  std::atomic<Slot*> chunks[max_chunks] = {};
+
+  Slot& slot(uint32_t id) const {
+    return chunks[id >> chunk_bits].load(std::memory_order_acquire)[id & (chunk_size - 1)];
+  }
+
+public:
+  uint32_t id_of(const String& name, size_t bw) {
+    const std::scoped_lock guard(lock);
+    auto [it, fresh] = ids.try_emplace({name, bw}, ids.size());
+    auto id = it->second;
+    if (fresh && (id & (chunk_size - 1)) == 0) {
+      ASSERT((id >> chunk_bits) < max_chunks, "Too many symbolic variables");
+      chunks[id >> chunk_bits].store(new Slot[chunk_size]{}, std::memory_order_release);
+    }
+    return id;
+  }
+
+  // Records `v` as the variable of `id`, unless one already is.
+  void publish(uint32_t id, const PtrVal& v) {
+    uintptr_t none = 0;
+    slot(id).compare_exchange_strong(none, v.bits(), std::memory_order_acq_rel);
+  }
+
+  PtrVal var(uint32_t id) const {
+    return PtrVal::from_bits(slot(id).load(std::memory_order_acquire));
+  }
+
+  size_t size() {
+    const std::scoped_lock guard(lock);
+    return ids.size();
+  }
+
+  // Note: the variables are roots of the reclamation passes, as their ids
+  // are never recycled.
+  template <typename F>
+  void for_each(F f) {
+    auto n = size();
+    for (uint32_t id = 0; id < n; id++) {
+      if (auto v = var(id)) f(v);
+    }
+  }
+};
+
+inline VarTable var_table;
+
+struct VarSetNode {
+  size_t hash;
+  uint32_t n;
+  uint32_t ids[];
+};
+
+inline size_t hash_var_ids(const uint32_t* ids, size_t n) {
+  size_t h = n;
+  for (size_t i = 0; i < n; i++) h = (h ^ ids[i]) * 0x9E3779B97F4A7C15ull;
+  return h ^ (h >> 29);
+}
+
+// A set of variables, as an interned node; nullptr is the empty set. Since
+// nodes are interned, equal sets are identical.
+class VarSet {
+  const VarSetNode* node = nullptr;
+
+public:
+  VarSet() = default;
+  explicit VarSet(const VarSetNode* node) : node(node) {}
+
+  // `ids` must be sorted, without duplicates
+  static VarSet of(const uint32_t* ids, size_t n);
+  static VarSet single(uint32_t id) { return of(&id, 1); }
+
+  size_t size() const { return node ? node->n : 0; }
+  bool empty() const { return !node; }
+  const uint32_t* ids_begin() const { return node ? node->ids : nullptr; }
+  const uint32_t* ids_end() const { return node ? node->ids + node->n : nullptr; }
+  bool contains(uint32_t id) const { return std::binary_search(ids_begin(), ids_end(), id); }
+
+  bool operator==(const VarSet& rhs) const { return node == rhs.node; }
+  bool operator!=(const VarSet& rhs) const { return node != rhs.node; }
+
+  VarSet operator|(const VarSet& rhs) const;
+
+  // Iterates over the variables (as values)
+  struct iterator {
+    const uint32_t* p;
+    PtrVal operator*() const { return var_table.var(*p); }
+    iterator& operator++() { ++p; return *this; }
+    bool operator!=(const iterator& rhs) const { return p != rhs.p; }
+  };
+  iterator begin() const { return { ids_begin() }; }
+  iterator end() const { return { ids_end() }; }
+};
+
+struct VarSetKey {
+  const uint32_t* ids;
+  size_t n;
+  size_t hash;
+};
+
+struct hash_VarSetNode {
+  using is_transparent = void;
+  size_t operator()(const VarSetNode* s) const noexcept { return s->hash; }
+  size_t operator()(const VarSetKey& k) const noexcept { return k.hash; }
+};
+
+struct equal_to_VarSetNode {
+  using is_transparent = void;
+  bool operator()(const VarSetNode* a, const VarSetNode* b) const { return a == b; }
+  bool operator()(const VarSetNode* a, const VarSetKey& k) const {
+    return a->n == k.n && std::equal(k.ids, k.ids + k.n, a->ids);
+  }
+  bool operator()(const VarSetKey& k, const VarSetNode* a) const { return (*this)(a, k); }
+};
+
+// Note: nodes are never freed; there are far fewer distinct sets than terms.
+class VarSetPool {
+  static constexpr size_t num_shards = 16;
+  struct alignas(64) Shard {
+    std::mutex lock;
+    phmap::flat_hash_set<const VarSetNode*, hash_VarSetNode, equal_to_VarSetNode> set;
+  };
+  Shard shards[num_shards];
+
+public:
+  const VarSetNode* intern(const uint32_t* ids, size_t n) {
+    VarSetKey key { ids, n, hash_var_ids(ids, n) };
+    auto& shard = shards[key.hash % num_shards];
+    const std::scoped_lock guard(shard.lock);
+    auto it = shard.set.find(key);
+    if (it != shard.set.end()) return *it;
+    auto node = static_cast<VarSetNode*>(::operator new(sizeof(VarSetNode) + n * sizeof(uint32_t)));
+    node->hash = key.hash;
+    node->n = n;
+    std::copy(ids, ids + n, node->ids);
+    shard.set.insert(node);
+    return node;
+  }
+};
+
+inline VarSetPool varset_pool;
+
+inline VarSet VarSet::of(const uint32_t* ids, size_t n) {
+  if (n == 0) return VarSet();
+  return VarSet(varset_pool.intern(ids, n));
+}
+
+inline VarSet VarSet::operator|(const VarSet& rhs) const {
+  if (node == rhs.node || rhs.empty()) return *this;
+  if (empty()) return rhs;
+  // a per-thread direct-mapped cache of unions
+  struct Entry { const VarSetNode *a, *b, *res; };
+  thread_local Entry cache[1024];
+  auto a = std::min(node, rhs.node), b = std::max(node, rhs.node);
+  auto& e = cache[((a->hash * 31) ^ b->hash) & 1023];
+  if (e.a == a && e.b == b) return VarSet(e.res);
+  thread_local std::vector<uint32_t> buf;
+  buf.clear();
+  std::set_union(a->ids, a->ids + a->n, b->ids, b->ids + b->n, std::back_inserter(buf));
+  const VarSetNode* res;
+  if (buf.size() == a->n) res = a;
+  else if (buf.size() == b->n) res = b;
+  else res = varset_pool.intern(buf.data(), buf.size());
+  e = { a, b, res };
+  return VarSet(res);
+}
+
+#endif
@@ -0,0 +1,53 @@
+// Checks that the hashes of terms and of constraint sets are structural: sets
+// of structurally equal terms, built in different orders and without
+// hash-consing (so at different addresses), hash equally.
+//   ./condset_test
+
+#define IMPURE_STATE
+#include "../gensym.hpp"
+inline Monitor& cov() { static Monitor m; return m; }
+extern const int stat_size = 144;
+extern const int statfs_size = 120;
+
+// The constraints over variables x0..x7 built from `seed`, in an order
+// shuffled by `order`
+std::vector<PtrVal> build(unsigned seed, unsigned order) {
+  std::mt19937 rng(seed);
+  std::vector<std::function<PtrVal()>> makers;
+  for (int k = 0; k < 16; k++) {
+    int a = rng() % 8, b = rng() % 8, c = rng() % 256;
+    auto op = std::vector<iOP>{ iOP::op_add, iOP::op_mul, iOP::op_xor, iOP::op_sub }[rng() % 4];
+    makers.push_back([=] {
+      auto x = make_SymV("x" + std::to_string(a), 8), y = make_SymV("x" + std::to_string(b), 8);
+      auto t = int_op_2(op, int_op_2(iOP::op_and, x, make_IntV(c, 8)), y);
+      return int_op_2(iOP::op_ult, t, make_IntV(c | 1, 8));
+    });
+  }
+  std::shuffle(makers.begin(), makers.end(), std::mt19937(order));
+  std::vector<PtrVal> cs;
+  for (auto& m : makers) cs.push_back(m());
+  return cs;
+}
+
+int main() {
+  use_hashcons = false;
+  use_symv_simplify = false;
+  size_t bad = 0, distinct = 0;
+  for (unsigned seed = 0; seed < 100; seed++) {
+    auto a = build(seed, 1), b = build(seed, 2);
+    ConstraintSet sa(a.begin(), a.end()), sb;
+    for (auto& c : b) sb.insert(c);
+    // not the same values, but the same terms
+    for (auto& c : a) if (!sb.contains(c)) distinct++;
+    if (sa.hash() != sb.hash()) bad++;
+    // removing the same term from both keeps the hashes equal
+    sa.erase(a[0]);
+    for (auto& c : b) {
+      if (c->hash() == a[0]->hash()) { sb.erase(c); break; }
+    }
+    if (sa.hash() != sb.hash()) bad++;
+  }
+  printf("%zu mismatches (%zu terms at different addresses)\n", bad, distinct);
+  ASSERT(distinct > 0, "Terms are hash-consed");
+  return bad == 0 ? 0 : 1;
+}
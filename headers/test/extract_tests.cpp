@@ -0,0 +1,54 @@
+// Extracts the test cases of an archive written with --test-archive into
+// .ktest (or .test) files, as they would have been written without it.
+//   ./extract_tests <output-dir>/tests.bin <dir> [test id...]
+
+#define IMPURE_STATE
+#include "../gensym.hpp"
+inline Monitor& cov() { static Monitor m; return m; }
+extern const int stat_size = 144;
+extern const int statfs_size = 120;
+
+static bool extract(const TestArchiveReader::Test& t, const std::string& dir) {
+  auto path = dir + "/" + std::to_string(t.id);
+  if (t.format == TestFormat::text) {
+    std::ofstream out(path + ".test", std::ios::binary);
+    out.write(t.data, t.size);
+    return bool(out);
+  }
+  KTest* b = kTest_fromBuffer(reinterpret_cast<const unsigned char*>(t.data), t.size);
+  if (!b) return false;
+  int success = kTest_toFile(b, (path + ".ktest").c_str());
+  kTest_free(b);
+  return success;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s <test archive> <dir> [test id...]\n", argv[0]);
+    return 1;
+  }
+  TestArchiveReader archive(argv[1]);
+  std::string dir = argv[2];
+  if (mkdir(dir.c_str(), 0777) == -1 && errno != EEXIST) {
+    fprintf(stderr, "cannot create %s\n", dir.c_str());
+    return 1;
+  }
+  size_t written = 0, failed = 0;
+  if (argc == 3) {
+    for (size_t i = 0; i < archive.size(); i++) {
+      if (extract(archive.at(i), dir)) written++; else failed++;
+    }
+  } else {
+    for (int i = 3; i < argc; i++) {
+      TestArchiveReader::Test t;
+      if (!archive.find(atoi(argv[i]), t)) {
+        fprintf(stderr, "no test %s in the archive\n", argv[i]);
+        failed++;
+      } else if (extract(t, dir)) written++; else failed++;
+    }
+  }
+  printf("%zu tests written to %s", written, dir.c_str());
+  if (failed) printf(", %zu failed", failed);
+  printf("\n");
+  return failed ? 1 : 0;
+}
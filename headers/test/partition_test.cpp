@@ -0,0 +1,38 @@
+// Checks that a test model merged from the models of independent partitions
+// satisfies every partition, even when the cached model found for one
+// partition assigns other values to the variables of another.
+//   ./partition_test
+
+#define IMPURE_STATE
+#include "../gensym.hpp"
+inline Monitor& cov() { static Monitor m; return m; }
+extern const int stat_size = 144;
+extern const int statfs_size = 120;
+
+PtrVal eq(const PtrVal& v, int c) { return int_op_2(iOP::op_eq, v, make_IntV(c, 32)); }
+
+int main() {
+  use_absint = false;
+  std::vector<PtrVal> xs;
+  for (int i = 0; i < 6; i++) xs.push_back(make_SymV("x" + std::to_string(i), 32));
+  CheckerSTP checker;
+  // cache, for each variable, a model of a superset of its later partition
+  // with another value for the next variable
+  for (int i = 0; i < 6; i++) {
+    ConstraintSet s;
+    s.insert(eq(xs[i], i));
+    s.insert(eq(xs[(i + 1) % 6], 100 + i));
+    ASSERT(checker.query_model(s) != nullptr, "Unsat superset");
+  }
+  PC pc(TrList<PtrVal>{});
+  for (int i = 0; i < 6; i++) pc.add(eq(xs[i], i));
+  ConstraintSet conds = pc.cond_set;
+  auto m = checker.query_partitioned_model(pc.uf, conds);
+  ASSERT(m != nullptr, "Unsat path condition");
+  size_t bad = 0;
+  for (int i = 0; i < 6; i++) {
+    if (checker.eval_model(m, xs[i]) != i) bad++;
+  }
+  printf("%zu of 6 partitions not satisfied (%lu sat superset hits)\n", bad, cex_superset_hits.load());
+  return bad == 0 ? 0 : 1;
+}
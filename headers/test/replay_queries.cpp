@@ -0,0 +1,82 @@
+// Replays a query log written with --dump-queries, through the caches of a
+// checker, and compares the results and times with the logged ones. Queries
+// logged from a solver session are counted apart.
+//   ./replay_queries <output-dir>/queries.bin [--solver=stp|z3|portfolio]
+//       [--no-obj-cache] [--no-cex-cache] [--no-br-cache] [--no-model-reuse]
+//       [--unsat-core] [--repeat=n]
+
+#define IMPURE_STATE
+#include "../gensym.hpp"
+inline Monitor& cov() { static Monitor m; return m; }
+extern const int stat_size = 144;
+extern const int statfs_size = 120;
+
+struct KindStat {
+  uint64_t queries = 0, mismatches = 0, logged_us = 0, replay_us = 0;
+};
+
+template <typename C>
+void replay(const char* path, int repeat) {
+  C checker;
+  std::map<std::pair<QueryKind, bool>, KindStat> stats;
+  for (int r = 0; r < repeat; r++) {
+    QueryLogReader log(path);
+    QueryLogReader::Query q;
+    while (log.next(q)) {
+      ConstraintSet conds;
+      for (auto& c : q.conds) conds.insert(c);
+      auto start = steady_clock::now();
+      auto res = checker.check_conds(conds);
+      auto us = duration_cast<microseconds>(steady_clock::now() - start).count();
+      auto& st = stats[{ q.kind, bool(q.flags & QueryLogFormat::Session) }];
+      st.queries++;
+      st.logged_us += q.latency_us;
+      st.replay_us += us;
+      if (res != q.result && res != solver_result::unknown && q.result != solver_result::unknown) st.mismatches++;
+    }
+  }
+  uint64_t total = 0;
+  for (auto& [k, st] : stats) {
+    total += st.queries;
+    auto name = std::string(query_kind_name(k.first)) + (k.second ? " (session)" : "");
+    printf("%-22s %8lu queries  logged %9.3fs  replayed %9.3fs  %lu mismatches\n",
+           name.c_str(), st.queries, st.logged_us / 1.0e6, st.replay_us / 1.0e6, st.mismatches);
+  }
+  printf("solver calls: %lu/%lu; cex cache (unsat subset/sat superset/subset model): %lu/%lu/%lu; model reuse: %lu; "
+         "unsat cores: %lu\n",
+         num_check_model.load(), total,
+         cex_unsat_subset_hits.load(), cex_superset_hits.load(), cex_subset_model_hits.load(),
+         model_reuse_num.load(), unsat_core_num.load());
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <query log> [--solver=stp|z3|portfolio] [--no-obj-cache] [--no-cex-cache] "
+                    "[--no-br-cache] [--no-model-reuse] [--unsat-core] [--repeat=n]\n", argv[0]);
+    return 1;
+  }
+  // rebuild the logged terms as they are
+  use_symv_simplify = false;
+  use_absint = false;
+  int repeat = 1;
+  for (int i = 2; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "--solver=stp") solver_kind = SolverKind::stp;
+    else if (a == "--solver=z3") solver_kind = SolverKind::z3;
+    else if (a == "--solver=portfolio") solver_kind = SolverKind::portfolio;
+    else if (a == "--no-obj-cache") use_objcache = false;
+    else if (a == "--no-cex-cache") use_cexcache = false;
+    else if (a == "--no-br-cache") use_brcache = false;
+    else if (a == "--no-model-reuse") use_model_reuse = false;
+    else if (a == "--unsat-core") use_unsat_core = true;
+    else if (a.rfind("--repeat=", 0) == 0) repeat = std::max(1, atoi(a.c_str() + 9));
+    else {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+  if (solver_kind == SolverKind::stp) replay<CheckerSTP>(argv[1], repeat);
+  else if (solver_kind == SolverKind::z3) replay<CheckerZ3>(argv[1], repeat);
+  else replay<CheckerPortfolio>(argv[1], repeat);
+  return 0;
+}
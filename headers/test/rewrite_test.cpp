@@ -0,0 +1,203 @@
+// Checks the rewrite rules applied by make_SymV: a few directed rewrites, and
+// random terms built with and without rewriting evaluate to the same values,
+// which lie in the abstract domains (BVDomain) of the terms.
+//   ./rewrite_test
+
+#define IMPURE_STATE
+#include "../gensym.hpp"
+inline Monitor& cov() { static Monitor m; return m; }
+extern const int stat_size = 144;
+extern const int statfs_size = 120;
+
+// Reference evaluator, values are masked to their bitwidth
+uint64_t mask(size_t bw) { return bw == 64 ? ~0ull : ((1ull << bw) - 1); }
+int64_t sx(uint64_t v, size_t bw) { return int64_t(v << (64 - bw)) >> (64 - bw); }
+std::map<std::string, uint64_t> env;
+uint64_t ev(PtrVal v) {
+  if (auto i = v->to_IntV()) return uint64_t(proj_IntV(v)) & mask(i->bw);
+  auto s = v->to_SymV();
+  if (!s->name.empty()) return env[s->name] & mask(s->bw);
+  size_t bw = s->bw;
+  auto a = [&](int k) { return ev(s->rands[k]); };
+  auto b = [&](int k) { return bw_of(s->rands[k]); };
+  uint64_t r;
+  switch (s->rator) {
+    case iOP::op_add: r = a(0) + a(1); break;
+    case iOP::op_sub: r = a(0) - a(1); break;
+    case iOP::op_mul: r = a(0) * a(1); break;
+    case iOP::op_and: r = a(0) & a(1); break;
+    case iOP::op_or: r = a(0) | a(1); break;
+    case iOP::op_xor: r = a(0) ^ a(1); break;
+    case iOP::op_udiv: r = a(0) / a(1); break;
+    case iOP::op_urem: r = a(0) % a(1); break;
+    case iOP::op_shl: r = a(0) << a(1); break;
+    case iOP::op_lshr: r = a(0) >> a(1); break;
+    case iOP::op_ashr: r = sx(a(0), bw) >> a(1); break;
+    case iOP::op_eq: r = a(0) == a(1); break;
+    case iOP::op_neq: r = a(0) != a(1); break;
+    case iOP::op_ult: r = a(0) < a(1); break;
+    case iOP::op_ule: r = a(0) <= a(1); break;
+    case iOP::op_ugt: r = a(0) > a(1); break;
+    case iOP::op_uge: r = a(0) >= a(1); break;
+    case iOP::op_slt: r = sx(a(0),b(0)) < sx(a(1),b(1)); break;
+    case iOP::op_sle: r = sx(a(0),b(0)) <= sx(a(1),b(1)); break;
+    case iOP::op_sgt: r = sx(a(0),b(0)) > sx(a(1),b(1)); break;
+    case iOP::op_sge: r = sx(a(0),b(0)) >= sx(a(1),b(1)); break;
+    case iOP::op_neg: r = !a(0); break;
+    case iOP::op_bvnot: r = ~a(0); break;
+    case iOP::op_zext: r = a(0); break;
+    case iOP::op_sext: r = sx(a(0), b(0)); break;
+    case iOP::op_trunc: r = a(0); break;
+    case iOP::op_concat: r = (a(0) << b(1)) | a(1); break;
+    case iOP::op_extract: r = a(0) >> proj_IntV(s->rands[2]); break;
+    case iOP::op_ite: r = a(0) ? a(1) : a(2); break;
+    default: ABORT("op");
+  }
+  return r & mask(bw);
+}
+
+// Every subterm's value must be in its domain
+bool in_dom(PtrVal v) {
+  auto s = v->to_SymV();
+  if (!s) return true;
+  if (!s->dom.contains(ev(v))) { std::cout << *v << " not in its domain\n"; return false; }
+  for (auto& r : s->rands) if (!in_dom(r)) return false;
+  return true;
+}
+
+std::mt19937_64 rng(42);
+std::vector<PtrVal> leaves8, leaves1;
+PtrVal gen(size_t bw, int d);
+PtrVal gen_bool(int d) {
+  if (d == 0 || rng() % 4 == 0) return leaves1[rng() % leaves1.size()];
+  switch (rng() % 4) {
+    case 0: return SymV::neg(gen_bool(d-1));
+    case 1: return ite(gen_bool(d-1), gen_bool(d-1), gen_bool(d-1));
+    default: {
+      static iOP cmps[] = {iOP::op_eq, iOP::op_neq, iOP::op_ult, iOP::op_sle, iOP::op_sgt, iOP::op_uge};
+      auto w = (rng() % 2) ? 8 : 16;
+      return int_op_2(cmps[rng() % 6], gen(w, d-1), gen(w, d-1));
+    }
+  }
+}
+PtrVal gen(size_t bw, int d) {
+  if (bw == 1) return gen_bool(d);
+  if (d == 0 || rng() % 5 == 0) {
+    if (rng() % 3 == 0) { int cs[] = {0, 1, -1, 3, 200}; return make_IntV(cs[rng()%5], bw); }
+    if (bw == 8) return leaves8[rng() % leaves8.size()];
+    auto x = gen(8, 0);
+    return bw == 16 ? int_op_2(iOP::op_concat, x, gen(8, 0)) : bv_zext(x, bw);
+  }
+  switch (rng() % 10) {
+    case 0: case 1: {
+      static iOP ops[] = {iOP::op_add, iOP::op_sub, iOP::op_mul, iOP::op_and, iOP::op_or, iOP::op_xor};
+      return int_op_2(ops[rng() % 6], gen(bw, d-1), gen(bw, d-1));
+    }
+    case 2: return ite(gen_bool(d-1), gen(bw, d-1), gen(bw, d-1));
+    case 3: if (bw > 8) return int_op_2(iOP::op_concat, gen(bw - 8, d-1), gen(8, d-1)); return gen(bw, d-1);
+    case 4: { // extract of a wider value
+      auto w = bw * 2 > 32 ? 32 : bw * 2;
+      if (w <= bw) return gen(bw, d-1);
+      auto lo = rng() % (w - bw + 1);
+      return bv_extract(gen(w, d-1), lo + bw - 1, lo);
+    }
+    case 5: if (bw > 8) return (rng()%2) ? bv_zext(gen(8, d-1), bw) : bv_sext(gen(8, d-1), bw); return gen(bw, d-1);
+    case 6: if (bw < 32) return trunc(gen(32, d-1), 32, bw); return gen(bw, d-1);
+    case 7: return int_op_1(iOP::op_bvnot, gen(bw, d-1));
+    case 8: {
+      static iOP ops[] = {iOP::op_shl, iOP::op_lshr, iOP::op_ashr, iOP::op_udiv, iOP::op_urem};
+      auto op = ops[rng() % 5];
+      return int_op_2(op, gen(bw, d-1), make_IntV(1 + rng() % (bw - 1), bw));
+    }
+    default: { auto x = gen(bw, d-1); return int_op_2(iOP::op_sub, x, x); }
+  }
+}
+
+int main() {
+  for (int i = 0; i < 4; i++) leaves8.push_back(make_SymV("b" + std::to_string(i), 8));
+  for (int i = 0; i < 3; i++) leaves1.push_back(make_SymV("c" + std::to_string(i), 1));
+  auto x = make_SymV("x", 32);
+  std::vector<PtrVal> bytes;
+  for (int i = 0; i < 4; i++) bytes.push_back(bv_extract(x, i*8+7, i*8));
+  auto cat = int_op_2(iOP::op_concat, int_op_2(iOP::op_concat, int_op_2(iOP::op_concat, bytes[3], bytes[2]), bytes[1]), bytes[0]);
+  ASSERT(cat == x, "concat fusion");
+  ASSERT(int_op_2(iOP::op_add, x, make_IntV(0, 32)) == x, "x+0");
+  auto c = int_op_2(iOP::op_eq, x, make_IntV(3, 32));
+  ASSERT(SymV::neg(SymV::neg(c)) == c, "double neg");
+  ASSERT(ite(c, x, x) == x, "ite same");
+  auto chain = int_op_2(iOP::op_add, int_op_2(iOP::op_add, x, make_IntV(1, 32)), make_IntV(2, 32));
+  ASSERT(chain == int_op_2(iOP::op_add, x, make_IntV(3, 32)), "chain");
+  ASSERT(int_op_2(iOP::op_eq, bv_zext(bytes[0], 32), make_IntV(300, 32))->to_IntV(), "zext range");
+  // Note: the rewritten term is built first, as the unrewritten one would
+  // otherwise be found in the hash-consing pool.
+  size_t sz_on = 0, sz_off = 0;
+  for (int t = 0; t < 3000; t++) {
+    auto seed = rng();
+    use_symv_simplify = true;  rng.seed(seed); auto e1 = gen(16, 5);
+    use_symv_simplify = false; rng.seed(seed); auto e0 = gen(16, 5);
+    ASSERT(bw_of(e0) == bw_of(e1), "bw");
+    if (auto s = e0->to_SymV()) sz_off += s->term_size; else sz_off++;
+    if (auto s = e1->to_SymV()) sz_on += s->term_size; else sz_on++;
+    for (int k = 0; k < 20; k++) {
+      for (int i = 0; i < 4; i++) env["b" + std::to_string(i)] = rng();
+      for (int i = 0; i < 3; i++) env["c" + std::to_string(i)] = rng();
+      if (ev(e0) != ev(e1)) { std::cout << *e0 << "\n=/=\n" << *e1 << "\n"; return 1; }
+      if (!in_dom(e0) || !in_dom(e1)) return 1;
+    }
+    rng.seed(seed + 1);
+  }
+  std::cout << "term size off/on: " << sz_off << " / " << sz_on << "\n";
+  for (size_t r = 0; r < size_t(RewriteRule::num_rules); r++) std::cout << rewrite_rule_names[r] << " " << rewrite_hits[r] << "\n";
+
+  // Conditions decided under the domains refined by a path condition agree
+  // with every assignment satisfying the path condition
+  auto b0 = leaves8[0];
+  auto doms = absint::refine(VarDomains(), int_op_2(iOP::op_ult, b0, make_IntV(10, 8)));
+  ASSERT(absint::decide(int_op_2(iOP::op_ult, b0, make_IntV(20, 8)), doms) == 1, "refined ult");
+  ASSERT(absint::decide(int_op_2(iOP::op_eq, bv_zext(b0, 32), make_IntV(15, 32)), doms) == 0, "refined zext");
+  // sext(b0) is never 0x00000080 (0x80 extends to 0xffffff80), so comparing
+  // it with that constant tells nothing about b0 = 0x80
+  auto is_80 = int_op_2(iOP::op_eq, b0, make_IntV(0x80, 8));
+  VarDomains sdoms;
+  absint::refine_cmp(sdoms, b0, iOP::op_uge, 0x80, 8);
+  absint::refine_cmp(sdoms, bv_sext(b0, 32), iOP::op_neq, 0x80, 32);
+  ASSERT(absint::decide(is_80, sdoms) == -1, "sext neq, other sign");
+  absint::refine_cmp(sdoms, bv_sext(b0, 32), iOP::op_eq, 0x80, 32);
+  ASSERT(absint::decide(is_80, sdoms) == -1, "sext eq, other sign");
+  absint::refine_cmp(sdoms, bv_sext(b0, 32), iOP::op_eq, 0xffffff80, 32);
+  ASSERT(absint::decide(is_80, sdoms) == 1, "sext eq");
+  static iOP cmps[] = {iOP::op_eq, iOP::op_neq, iOP::op_ult, iOP::op_ule, iOP::op_ugt,
+                       iOP::op_uge, iOP::op_slt, iOP::op_sle, iOP::op_sgt, iOP::op_sge};
+  auto bound = [&](PtrVal t, size_t bw) {
+    auto c = make_IntV(int64_t(rng() % 256) - 128, bw);
+    return (rng() % 2) ? int_op_2(cmps[rng() % 10], t, c) : int_op_2(cmps[rng() % 10], c, t);
+  };
+  size_t decided = 0;
+  for (int t = 0; t < 3000; t++) {
+    VarDomains doms;
+    std::vector<PtrVal> pc;
+    for (int k = 0; k < 3; k++) {
+      auto x = leaves8[rng() % leaves8.size()];
+      auto c = (rng() % 3) ? bound(x, 8) : bound((rng() % 2) ? bv_zext(x, 16) : bv_sext(x, 16), 16);
+      if (rng() % 4 == 0) c = SymV::neg(c);
+      if (c->to_IntV()) continue;
+      pc.push_back(c);
+      doms = absint::refine(doms, c);
+    }
+    auto q = bound(gen(8, 2), 8);
+    if (q->to_IntV()) continue;
+    auto truth = absint::decide(q, doms);
+    if (truth < 0) continue;
+    decided++;
+    for (int k = 0; k < 500; k++) {
+      for (int i = 0; i < 4; i++) env["b" + std::to_string(i)] = rng();
+      for (int i = 0; i < 3; i++) env["c" + std::to_string(i)] = rng();
+      if (std::all_of(pc.begin(), pc.end(), [](auto& c) { return ev(c) == 1; }) && ev(q) != uint64_t(truth)) {
+        std::cout << *q << " wrongly decided\n";
+        return 1;
+      }
+    }
+  }
+  std::cout << "decided by the abstract domain: " << decided << "\n";
+  return 0;
+}
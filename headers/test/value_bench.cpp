@@ -0,0 +1,106 @@
+// Microbenchmark of value operations on the hot path: down-casts, int_op_2,
+// and Mem::at. The RTTI rows time the same down-casts through dynamic_cast,
+// as a baseline for the kind-tag based casts.
+//   ./value_bench [iterations]
+
+#define IMPURE_STATE
+#include "../gensym.hpp"
+
+inline Monitor& cov() { static Monitor m; return m; }
+extern const int stat_size = 144;
+extern const int statfs_size = 120;
+
+template <typename F>
+void bench(const char* name, size_t n, F f) {
+  auto start = steady_clock::now();
+  size_t sink = f(n);
+  auto end = steady_clock::now();
+  auto ns = duration_cast<nanoseconds>(end - start).count();
+  printf("%-28s %8.2f ns/op  (%zu)\n", name, double(ns) / n, sink);
+}
+
+int main(int argc, char** argv) {
+  size_t n = argc > 1 ? atol(argv[1]) : 10000000;
+  std::vector<PtrVal> vals;
+  for (int i = 0; i < 64; i++) {
+    vals.push_back(make_IntV(i, 32));
+    vals.push_back(make_SymV("x" + std::to_string(i), 32));
+    vals.push_back(make_LocV(i, LocV::kHeap, 8));
+  }
+
+  bench("to_IntV/to_SymV (tag)", n, [&](size_t n) {
+    size_t c = 0;
+    for (size_t k = 0; k < n; k++) {
+      auto& v = vals[k % vals.size()];
+      if (v->to_IntV()) c++;
+      if (v->to_SymV()) c += 2;
+    }
+    return c;
+  });
+  bench("to_IntV/to_SymV (RTTI)", n, [&](size_t n) {
+    size_t c = 0;
+    for (size_t k = 0; k < n; k++) {
+      auto v = vals[k % vals.size()].get();
+      if (dynamic_cast<IntV*>(v)) c++;
+      if (dynamic_cast<SymV*>(v)) c += 2;
+    }
+    return c;
+  });
+
+  auto x = make_SymV("x", 32);
+  bench("int_op_2 (concrete)", n, [&](size_t n) {
+    size_t c = 0;
+    for (size_t k = 0; k < n; k++) {
+      auto v = int_op_2(iOP::op_add, vals[(k % 64) * 3], vals[((k + 1) % 64) * 3]);
+      c += v->to_IntV()->i >> 32;
+    }
+    return c;
+  });
+  bench("int_op_2 (symbolic)", n, [&](size_t n) {
+    size_t c = 0;
+    for (size_t k = 0; k < n; k++) {
+      auto v = int_op_2(iOP::op_add, x, vals[(k % 64) * 3]);
+      c += v->to_SymV()->term_size;
+    }
+    return c;
+  });
+  // new nodes over an operand with 64 variables
+  auto sum = vals[1];
+  for (size_t i = 1; i < 64; i++) sum = int_op_2(iOP::op_add, sum, vals[i * 3 + 1]);
+  bench("SymV ctor (64 vars)", n / 10, [&](size_t n) {
+    size_t c = 0;
+    for (size_t k = 0; k < n; k++) {
+      auto v = int_op_2(iOP::op_mul, sum, make_IntV(k + 2, 32));
+      c += v->to_SymV()->vars.size();
+    }
+    return c;
+  });
+
+  // 64 words written as whole values, then read back whole and by halves
+  Mem mem(List<PtrVal>{});
+  mem.alloc(64 * 4);
+  for (size_t i = 0; i < 64; i++) mem.update(i * 4, vals[i * 3 + (i % 2)], 4);
+  bench("Mem::at (intact)", n, [&](size_t n) {
+    size_t c = 0;
+    for (size_t k = 0; k < n; k++) c += mem.at((k % 64) * 4, 4)->get_bw();
+    return c;
+  });
+  bench("Mem::at (partial)", n / 10, [&](size_t n) {
+    size_t c = 0;
+    for (size_t k = 0; k < n; k++) c += mem.at((k % 63) * 4 + 2, 4)->get_bw();
+    return c;
+  });
+
+  // 64 words written byte by byte, then read back whole
+  Mem bytes(List<PtrVal>{});
+  bytes.alloc(64 * 4);
+  for (size_t i = 0; i < 64; i++)
+    for (size_t b = 0; b < 4; b++)
+      bytes.update(i * 4 + b, bv_extract(vals[i * 3 + (i % 2)], b * 8 + 7, b * 8), 1);
+  bench("Mem::at (bytewise)", n / 10, [&](size_t n) {
+    size_t c = 0;
+    for (size_t k = 0; k < n; k++) c += bytes.at((k % 64) * 4, 4)->get_bw();
+    return c;
+  });
+  return 0;
+}